@@ -0,0 +1,79 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include "../Components/TransformComponent.h"
+#include "../Components/BoxColliderComponent.h"
+
+// World-space axis-aligned bounding box of a collider
+struct Aabb {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+
+    bool Overlaps(const Aabb& other) const {
+        return minX <= other.maxX && maxX >= other.minX &&
+               minY <= other.maxY && maxY >= other.minY;
+    }
+
+    bool Contains(const Aabb& other) const {
+        return minX <= other.minX && minY <= other.minY &&
+               maxX >= other.maxX && maxY >= other.maxY;
+    }
+
+    float GetPerimeter() const {
+        return 2.0f * ((maxX - minX) + (maxY - minY));
+    }
+
+    Aabb Expanded(float margin) const {
+        return {minX - margin, minY - margin, maxX + margin, maxY + margin};
+    }
+
+    // Slab test of the segment going from start to end
+    bool IntersectsSegment(const glm::vec2& start, const glm::vec2& end) const {
+        const glm::vec2 direction = end - start;
+        const float mins[2] = {minX, minY};
+        const float maxs[2] = {maxX, maxY};
+        float enter = 0.0f;
+        float exit = 1.0f;
+        for(int axis = 0; axis < 2; axis++) {
+            if(std::abs(direction[axis]) < 1e-6f) {
+                if(start[axis] < mins[axis] || start[axis] > maxs[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            auto near = (mins[axis] - start[axis]) / direction[axis];
+            auto far = (maxs[axis] - start[axis]) / direction[axis];
+            if(near > far) {
+                std::swap(near, far);
+            }
+            enter = std::max(enter, near);
+            exit = std::min(exit, far);
+            if(enter > exit) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static Aabb Combine(const Aabb& a, const Aabb& b) {
+        return {std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+    }
+};
+
+inline Aabb ComputeAabb(const TransformComponent& transform, const BoxColliderComponent& collider) {
+    const float minX = transform.position.x + collider.offset.x;
+    const float minY = transform.position.y + collider.offset.y;
+    return {
+        minX,
+        minY,
+        minX + collider.width * transform.scale.x,
+        minY + collider.height * transform.scale.y
+    };
+}
+
+#endif
@@ -0,0 +1,251 @@
+#include "AabbTree.h"
+#include <algorithm>
+
+AabbTree::AabbTree(float margin): margin(margin) {
+}
+
+std::int32_t AabbTree::allocateNode() {
+    if(freeList == NULL_NODE) {
+        nodes.push_back(Node{});
+        freeList = static_cast<std::int32_t>(nodes.size() - 1);
+        nodes[freeList].parent = NULL_NODE;
+    }
+
+    const auto node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node].parent = NULL_NODE;
+    nodes[node].child1 = NULL_NODE;
+    nodes[node].child2 = NULL_NODE;
+    nodes[node].height = 0;
+    nodes[node].userData = 0;
+    return node;
+}
+
+void AabbTree::freeNode(std::int32_t node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+std::int32_t AabbTree::CreateProxy(const Aabb& bounds, std::uint32_t userData) {
+    const auto proxy = allocateNode();
+    nodes[proxy].bounds = bounds.Expanded(margin);
+    nodes[proxy].userData = userData;
+    insertLeaf(proxy);
+    proxyCount++;
+    return proxy;
+}
+
+void AabbTree::DestroyProxy(std::int32_t proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    proxyCount--;
+}
+
+bool AabbTree::MoveProxy(std::int32_t proxy, const Aabb& bounds) {
+    if(nodes[proxy].bounds.Contains(bounds)) {
+        return false;
+    }
+
+    removeLeaf(proxy);
+    nodes[proxy].bounds = bounds.Expanded(margin);
+    insertLeaf(proxy);
+    return true;
+}
+
+std::uint32_t AabbTree::GetUserData(std::int32_t proxy) const {
+    return nodes[proxy].userData;
+}
+
+const Aabb& AabbTree::GetFatBounds(std::int32_t proxy) const {
+    return nodes[proxy].bounds;
+}
+
+std::size_t AabbTree::GetProxyCount() const {
+    return proxyCount;
+}
+
+int AabbTree::GetHeight() const {
+    return root == NULL_NODE ? 0 : nodes[root].height;
+}
+
+void AabbTree::insertLeaf(std::int32_t leaf) {
+    if(root == NULL_NODE) {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Walk down to the sibling whose pairing costs the least perimeter, counting
+    // the growth inherited by every ancestor on the way
+    const auto leafBounds = nodes[leaf].bounds;
+    auto index = root;
+    while(!nodes[index].IsLeaf()) {
+        const auto& node = nodes[index];
+        const auto area = node.bounds.GetPerimeter();
+        const auto combinedArea = Aabb::Combine(node.bounds, leafBounds).GetPerimeter();
+
+        // Cost of making a new parent for this node and the leaf
+        const auto cost = 2.0f * combinedArea;
+        // Minimum cost of pushing the leaf further down the tree
+        const auto inheritanceCost = 2.0f * (combinedArea - area);
+
+        const auto descendCost = [&](std::int32_t child) {
+            const auto& childBounds = nodes[child].bounds;
+            const auto newArea = Aabb::Combine(leafBounds, childBounds).GetPerimeter();
+            return nodes[child].IsLeaf() ? newArea + inheritanceCost : newArea - childBounds.GetPerimeter() + inheritanceCost;
+        };
+        const auto cost1 = descendCost(node.child1);
+        const auto cost2 = descendCost(node.child2);
+
+        if(cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    const auto sibling = index;
+    const auto oldParent = nodes[sibling].parent;
+    const auto newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = Aabb::Combine(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if(oldParent == NULL_NODE) {
+        root = newParent;
+    } else if(nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    refitAncestors(nodes[leaf].parent);
+}
+
+void AabbTree::removeLeaf(std::int32_t leaf) {
+    if(leaf == root) {
+        root = NULL_NODE;
+        return;
+    }
+
+    // The sibling takes the place of the parent
+    const auto parent = nodes[leaf].parent;
+    const auto grandParent = nodes[parent].parent;
+    const auto sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    freeNode(parent);
+
+    if(grandParent == NULL_NODE) {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        return;
+    }
+
+    if(nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    refitAncestors(grandParent);
+}
+
+// Balances and refits the bounds and heights from node up to the root
+void AabbTree::refitAncestors(std::int32_t node) {
+    auto index = node;
+    while(index != NULL_NODE) {
+        index = balance(index);
+
+        auto& current = nodes[index];
+        const auto& child1 = nodes[current.child1];
+        const auto& child2 = nodes[current.child2];
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.bounds = Aabb::Combine(child1.bounds, child2.bounds);
+
+        index = current.parent;
+    }
+}
+
+// When the heights of the children of A differ by more than one, the taller child
+// moves up to A's place with A as its first child. It keeps its own taller child
+// and hands the other one to A. Returns the node now at A's place
+std::int32_t AabbTree::balance(std::int32_t iA) {
+    auto& a = nodes[iA];
+    if(a.IsLeaf() || a.height < 2) {
+        return iA;
+    }
+
+    const auto iB = a.child1;
+    const auto iC = a.child2;
+    const auto heightDifference = nodes[iC].height - nodes[iB].height;
+
+    // Moves up iUp, the taller child of A, keeping its taller child and handing the other to A
+    const auto rotateUp = [this, iA](std::int32_t iUp, std::int32_t iStay) {
+        auto& a = nodes[iA];
+        auto& up = nodes[iUp];
+        const auto iF = up.child1;
+        const auto iG = up.child2;
+
+        up.child1 = iA;
+        up.parent = a.parent;
+        a.parent = iUp;
+        if(up.parent == NULL_NODE) {
+            root = iUp;
+        } else if(nodes[up.parent].child1 == iA) {
+            nodes[up.parent].child1 = iUp;
+        } else {
+            nodes[up.parent].child2 = iUp;
+        }
+
+        const auto iKeep = nodes[iF].height > nodes[iG].height ? iF : iG;
+        const auto iGive = iKeep == iF ? iG : iF;
+        up.child2 = iKeep;
+        if(a.child1 == iUp) {
+            a.child1 = iGive;
+        } else {
+            a.child2 = iGive;
+        }
+        nodes[iGive].parent = iA;
+
+        a.bounds = Aabb::Combine(nodes[iStay].bounds, nodes[iGive].bounds);
+        a.height = 1 + std::max(nodes[iStay].height, nodes[iGive].height);
+        up.bounds = Aabb::Combine(a.bounds, nodes[iKeep].bounds);
+        up.height = 1 + std::max(a.height, nodes[iKeep].height);
+        return iUp;
+    };
+
+    if(heightDifference > 1) {
+        return rotateUp(iC, iB);
+    }
+    if(heightDifference < -1) {
+        return rotateUp(iB, iC);
+    }
+    return iA;
+}
+
+bool AabbTree::validateNode(std::int32_t node, std::size_t& leafCount) const {
+    const auto& current = nodes[node];
+    if(current.IsLeaf()) {
+        leafCount++;
+        return current.height == 0 && current.child2 == NULL_NODE;
+    }
+
+    const auto& child1 = nodes[current.child1];
+    const auto& child2 = nodes[current.child2];
+    return child1.parent == node && child2.parent == node &&
+           current.height == 1 + std::max(child1.height, child2.height) &&
+           current.bounds.Contains(child1.bounds) && current.bounds.Contains(child2.bounds) &&
+           validateNode(current.child1, leafCount) && validateNode(current.child2, leafCount);
+}
+
+bool AabbTree::Validate() const {
+    if(root == NULL_NODE) {
+        return proxyCount == 0;
+    }
+
+    std::size_t leafCount = 0;
+    return nodes[root].parent == NULL_NODE && validateNode(root, leafCount) && leafCount == proxyCount;
+}
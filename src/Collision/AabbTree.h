@@ -0,0 +1,179 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Aabb.h"
+
+/*******************************************
+ AabbTree
+******************************************
+ Dynamic bounding volume hierarchy over fattened boxes. A leaf (proxy)
+ stores its box grown by a margin, so a collider moving less than that
+ margin leaves the tree untouched. Insertions pick the sibling that grows
+ the tree's perimeter the least and rotations keep it balanced
+*******************************************/
+class AabbTree {
+    public:
+        static constexpr std::int32_t NULL_NODE = -1;
+
+        explicit AabbTree(float margin = 8.0f);
+
+        std::int32_t CreateProxy(const Aabb& bounds, std::uint32_t userData);
+        void DestroyProxy(std::int32_t proxy);
+
+        // Returns true when the bounds left the fat bounds and the proxy was reinserted
+        bool MoveProxy(std::int32_t proxy, const Aabb& bounds);
+
+        std::uint32_t GetUserData(std::int32_t proxy) const;
+        const Aabb& GetFatBounds(std::int32_t proxy) const;
+        std::size_t GetProxyCount() const;
+        int GetHeight() const;
+
+        // Checks the links, heights and bounds of the whole tree
+        bool Validate() const;
+
+        // Calls callback(proxyA, proxyB) once for every two proxies whose fat bounds overlap,
+        // descending the tree against itself rather than querying it once per proxy
+        template <typename TCallback>
+        void QueryPairs(TCallback callback);
+
+        // Calls callback(proxy) for every proxy whose fat bounds overlap the region,
+        // the query stops as soon as the callback returns false
+        template <typename TCallback>
+        void QueryRegion(const Aabb& region, TCallback callback) const;
+
+        // Calls callback(proxy) for every proxy whose fat bounds the segment crosses,
+        // the query stops as soon as the callback returns false
+        template <typename TCallback>
+        void QueryRay(const glm::vec2& start, const glm::vec2& end, TCallback callback) const;
+
+    private:
+        // Query stack entries kept on the call stack, plenty for a tree kept
+        // balanced by the rotations. Deeper trees spill onto the heap
+        static constexpr std::size_t QUERY_STACK_SIZE = 256;
+
+        struct Node {
+            Aabb bounds;
+            // Next free node while the node is in the free list
+            std::int32_t parent;
+            std::int32_t child1;
+            std::int32_t child2;
+            // 0 for leaves, -1 for free nodes
+            std::int32_t height;
+            std::uint32_t userData;
+
+            bool IsLeaf() const { return child1 == NULL_NODE; }
+        };
+
+        float margin;
+        std::vector<Node> nodes;
+        std::int32_t root = NULL_NODE;
+        std::int32_t freeList = NULL_NODE;
+        std::size_t proxyCount = 0;
+        // Node pairs left to visit by QueryPairs, a node paired with itself stands for its own subtree
+        std::vector<std::pair<std::int32_t, std::int32_t>> pairStack;
+
+        std::int32_t allocateNode();
+        void freeNode(std::int32_t node);
+        void insertLeaf(std::int32_t leaf);
+        void removeLeaf(std::int32_t leaf);
+        void refitAncestors(std::int32_t node);
+        std::int32_t balance(std::int32_t node);
+        bool validateNode(std::int32_t node, std::size_t& leafCount) const;
+
+        template <typename TTest, typename TCallback>
+        void query(TTest overlaps, TCallback callback) const;
+};
+
+template <typename TTest, typename TCallback>
+void AabbTree::query(TTest overlaps, TCallback callback) const {
+    if(root == NULL_NODE) {
+        return;
+    }
+
+    std::int32_t fixedStack[QUERY_STACK_SIZE];
+    std::vector<std::int32_t> heapStack;
+    std::int32_t* stack = fixedStack;
+    std::size_t stackCapacity = QUERY_STACK_SIZE;
+    std::size_t stackSize = 0;
+    stack[stackSize++] = root;
+    while(stackSize > 0) {
+        const auto& node = nodes[stack[--stackSize]];
+        if(!overlaps(node.bounds)) {
+            continue;
+        }
+
+        if(node.IsLeaf()) {
+            if(!callback(static_cast<std::int32_t>(&node - nodes.data()))) {
+                return;
+            }
+            continue;
+        }
+
+        if(stackSize + 2 > stackCapacity) {
+            if(stack == fixedStack) {
+                heapStack.assign(fixedStack, fixedStack + stackSize);
+            }
+            stackCapacity *= 2;
+            heapStack.resize(stackCapacity);
+            stack = heapStack.data();
+        }
+        stack[stackSize++] = node.child1;
+        stack[stackSize++] = node.child2;
+    }
+}
+
+template <typename TCallback>
+void AabbTree::QueryPairs(TCallback callback) {
+    if(root == NULL_NODE) {
+        return;
+    }
+
+    pairStack.clear();
+    pairStack.emplace_back(root, root);
+    while(!pairStack.empty()) {
+        const auto [iA, iB] = pairStack.back();
+        pairStack.pop_back();
+        const auto& a = nodes[iA];
+        const auto& b = nodes[iB];
+
+        if(iA == iB) {
+            if(!a.IsLeaf()) {
+                pairStack.emplace_back(a.child1, a.child1);
+                pairStack.emplace_back(a.child2, a.child2);
+                pairStack.emplace_back(a.child1, a.child2);
+            }
+            continue;
+        }
+
+        if(!a.bounds.Overlaps(b.bounds)) {
+            continue;
+        }
+
+        if(a.IsLeaf() && b.IsLeaf()) {
+            callback(iA, iB);
+        } else if(b.IsLeaf() || (!a.IsLeaf() && a.bounds.GetPerimeter() >= b.bounds.GetPerimeter())) {
+            // Split the larger node first
+            pairStack.emplace_back(a.child1, iB);
+            pairStack.emplace_back(a.child2, iB);
+        } else {
+            pairStack.emplace_back(iA, b.child1);
+            pairStack.emplace_back(iA, b.child2);
+        }
+    }
+}
+
+template <typename TCallback>
+void AabbTree::QueryRegion(const Aabb& region, TCallback callback) const {
+    query([&region](const Aabb& bounds) { return bounds.Overlaps(region); }, callback);
+}
+
+template <typename TCallback>
+void AabbTree::QueryRay(const glm::vec2& start, const glm::vec2& end, TCallback callback) const {
+    query([&start, &end](const Aabb& bounds) { return bounds.IntersectsSegment(start, end); }, callback);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "AabbTreeBroadphase.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    constexpr std::uint32_t NOT_IN_FRAME = std::numeric_limits<std::uint32_t>::max();
+}
+
+AabbTreeBroadphase::AabbTreeBroadphase(float margin): tree(margin) {
+}
+
+const AabbTree& AabbTreeBroadphase::GetTree() const {
+    return tree;
+}
+
+// Creates the proxies of the new colliders, moves the others and destroys the ones gone
+void AabbTreeBroadphase::syncProxies(const ColliderBounds& colliders) {
+    const auto colliderCount = static_cast<std::uint32_t>(colliders.GetSize());
+    std::size_t maxEntityId = proxyOfEntity.empty() ? 0 : proxyOfEntity.size() - 1;
+    for(const auto entityId : colliders.entityIds) {
+        maxEntityId = std::max(maxEntityId, entityId);
+    }
+    proxyOfEntity.resize(maxEntityId + 1, AabbTree::NULL_NODE);
+    frameIndexOfEntity.assign(maxEntityId + 1, NOT_IN_FRAME);
+
+    bounds.clear();
+    filters.clear();
+    seenEntities.clear();
+    for(std::uint32_t i = 0; i < colliderCount; i++) {
+        const auto entityId = static_cast<std::uint32_t>(colliders.entityIds[i]);
+        frameIndexOfEntity[entityId] = i;
+        bounds.push_back(colliders.GetAabb(i));
+        filters.push_back(colliders.GetFilter(i));
+        seenEntities.push_back(entityId);
+
+        auto& proxy = proxyOfEntity[entityId];
+        if(proxy == AabbTree::NULL_NODE) {
+            proxy = tree.CreateProxy(bounds.back(), entityId);
+        } else {
+            tree.MoveProxy(proxy, bounds.back());
+        }
+    }
+
+    for(const auto entityId : trackedEntities) {
+        if(frameIndexOfEntity[entityId] == NOT_IN_FRAME && proxyOfEntity[entityId] != AabbTree::NULL_NODE) {
+            tree.DestroyProxy(proxyOfEntity[entityId]);
+            proxyOfEntity[entityId] = AabbTree::NULL_NODE;
+        }
+    }
+    trackedEntities.swap(seenEntities);
+}
+
+void AabbTreeBroadphase::FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) {
+    syncProxies(colliders);
+
+    // The fat bounds overlapping, the layers then the exact boxes decide
+    tree.QueryPairs([&](std::int32_t proxyA, std::int32_t proxyB) {
+        const auto a = frameIndexOfEntity[tree.GetUserData(proxyA)];
+        const auto b = frameIndexOfEntity[tree.GetUserData(proxyB)];
+        if(filters[a].Accepts(filters[b]) && bounds[a].Overlaps(bounds[b])) {
+            pairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    });
+}
+
+void AabbTreeBroadphase::QueryRegion(const Aabb& region, std::vector<std::uint32_t>& colliderIndices) const {
+    tree.QueryRegion(region, [&](std::int32_t proxy) {
+        const auto index = frameIndexOfEntity[tree.GetUserData(proxy)];
+        if(bounds[index].Overlaps(region)) {
+            colliderIndices.push_back(index);
+        }
+        return true;
+    });
+}
+
+void AabbTreeBroadphase::QueryRay(const glm::vec2& start, const glm::vec2& end, std::vector<std::uint32_t>& colliderIndices) const {
+    tree.QueryRay(start, end, [&](std::int32_t proxy) {
+        const auto index = frameIndexOfEntity[tree.GetUserData(proxy)];
+        if(bounds[index].IntersectsSegment(start, end)) {
+            colliderIndices.push_back(index);
+        }
+        return true;
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef AABBTREEBROADPHASE_H
+#define AABBTREEBROADPHASE_H
+
+#include "AabbTree.h"
+#include "Broadphase.h"
+
+/*******************************************
+ AabbTreeBroadphase
+******************************************
+ Keeps one AabbTree proxy per collider entity across frames, and finds the
+ pairs by descending the tree against itself. Handles scenes
+ mixing colliders of very different sizes, where a uniform grid cannot fit
+ them all. The tree also answers region and ray queries on the last frame
+*******************************************/
+class AabbTreeBroadphase: public IBroadphase {
+    public:
+        explicit AabbTreeBroadphase(float margin = 8.0f);
+
+        void FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) override;
+
+        // Indices of the colliders of the last FindPairs overlapping the region
+        void QueryRegion(const Aabb& region, std::vector<std::uint32_t>& colliderIndices) const;
+
+        // Indices of the colliders of the last FindPairs crossed by the segment from start to end
+        void QueryRay(const glm::vec2& start, const glm::vec2& end, std::vector<std::uint32_t>& colliderIndices) const;
+
+        const AabbTree& GetTree() const;
+
+    private:
+        AabbTree tree;
+        // Indexed by entity id
+        std::vector<std::int32_t> proxyOfEntity;
+        std::vector<std::uint32_t> frameIndexOfEntity;
+        std::vector<std::uint32_t> trackedEntities;
+        std::vector<std::uint32_t> seenEntities;
+        // Exact boxes and layers of the last frame, by collider index
+        std::vector<Aabb> bounds;
+        std::vector<CollisionFilter> filters;
+
+        void syncProxies(const ColliderBounds& colliders);
+};
+
+#endif
@@ -0,0 +1,14 @@
+#include "Broadphase.h"
+#include "OverlapKernel.h"
+
+void BruteForceBroadphase::FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) {
+    const auto colliderCount = static_cast<std::uint32_t>(colliders.GetSize());
+    // The first colliders test the most candidates, small chunks keep the threads evenly loaded
+    findPairsInParallel(colliderCount, 64, pairs, [&](std::size_t begin, std::size_t end, std::vector<ColliderPair>& threadPairs) {
+        for(auto i = static_cast<std::uint32_t>(begin); i < end; i++) {
+            ForEachOverlap(colliders.GetAabb(i), colliders.GetFilter(i), colliders, i + 1, colliderCount, [&](std::uint32_t j) {
+                threadPairs.emplace_back(i, j);
+            });
+        }
+    });
+}
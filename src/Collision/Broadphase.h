@@ -0,0 +1,158 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Aabb.h"
+#include "../Jobs/JobSystem.h"
+
+// The layers a collider is on and the layers it collides with, see BoxColliderComponent
+struct CollisionFilter {
+    std::uint32_t layer = BoxColliderComponent::DEFAULT_LAYER;
+    std::uint32_t mask = BoxColliderComponent::ALL_LAYERS;
+
+    bool Accepts(const CollisionFilter& other) const {
+        return (mask & other.layer) != 0 && (other.mask & layer) != 0;
+    }
+};
+
+// The colliders handed to the broadphase, computed once per frame. Each coordinate has its
+// own array so the overlap kernel loads several consecutive colliders at once. A collider
+// is identified by its index in the arrays
+struct ColliderBounds {
+    std::vector<std::size_t> entityIds;
+    std::vector<float> minX;
+    std::vector<float> minY;
+    std::vector<float> maxX;
+    std::vector<float> maxY;
+    std::vector<std::uint32_t> layers;
+    std::vector<std::uint32_t> masks;
+
+    std::size_t GetSize() const {
+        return entityIds.size();
+    }
+
+    void Clear() {
+        entityIds.clear();
+        minX.clear();
+        minY.clear();
+        maxX.clear();
+        maxY.clear();
+        layers.clear();
+        masks.clear();
+    }
+
+    void Add(std::size_t entityId, const Aabb& bounds, CollisionFilter filter = {}) {
+        entityIds.push_back(entityId);
+        minX.push_back(bounds.minX);
+        minY.push_back(bounds.minY);
+        maxX.push_back(bounds.maxX);
+        maxY.push_back(bounds.maxY);
+        layers.push_back(filter.layer);
+        masks.push_back(filter.mask);
+    }
+
+    Aabb GetAabb(std::size_t index) const {
+        return {minX[index], minY[index], maxX[index], maxY[index]};
+    }
+
+    CollisionFilter GetFilter(std::size_t index) const {
+        return {layers[index], masks[index]};
+    }
+
+    // Whether the layers of the two colliders let them collide, checked before their bounds
+    bool CanCollide(std::size_t a, std::size_t b) const {
+        return (masks[a] & layers[b]) != 0 && (masks[b] & layers[a]) != 0;
+    }
+
+    void SetAabb(std::size_t index, const Aabb& bounds) {
+        minX[index] = bounds.minX;
+        minY[index] = bounds.minY;
+        maxX[index] = bounds.maxX;
+        maxY[index] = bounds.maxY;
+    }
+
+    // Moves the last collider into the slot, the order is not kept
+    void SwapRemove(std::size_t index) {
+        entityIds[index] = entityIds.back();
+        minX[index] = minX.back();
+        minY[index] = minY.back();
+        maxX[index] = maxX.back();
+        maxY[index] = maxY.back();
+        layers[index] = layers.back();
+        masks[index] = masks.back();
+        entityIds.pop_back();
+        minX.pop_back();
+        minY.pop_back();
+        maxX.pop_back();
+        maxY.pop_back();
+        layers.pop_back();
+        masks.pop_back();
+    }
+};
+
+// Indices of two overlapping colliders, lower index first
+using ColliderPair = std::pair<std::uint32_t, std::uint32_t>;
+
+/*******************************************
+ IBroadphase
+******************************************
+ Finds the overlapping pairs among the colliders of a frame
+ without testing every pair against each other
+*******************************************/
+class IBroadphase {
+    public:
+        virtual ~IBroadphase() = default;
+
+        // Appends every pair of overlapping colliders whose layers let them collide
+        // exactly once, in no particular order
+        virtual void FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) = 0;
+
+        // Broadphases able to split their search run it on these threads, none runs it on the caller
+        void SetJobSystem(JobSystem* jobSystem) {
+            this->jobSystem = jobSystem;
+        }
+
+    protected:
+        JobSystem* jobSystem = nullptr;
+
+        // Calls findRange(begin, end, threadPairs) over [0, count), split across the job
+        // system when there is one. Each thread appends to its own buffer, the buffers
+        // are then moved to the end of pairs
+        template <typename TFindRange>
+        void findPairsInParallel(std::size_t count, std::size_t grainSize, std::vector<ColliderPair>& pairs, TFindRange&& findRange) {
+            if(jobSystem == nullptr) {
+                findRange(std::size_t{0}, count, pairs);
+                return;
+            }
+
+            threadBuffers.resize(jobSystem->GetThreadCount());
+            for(auto& buffer : threadBuffers) {
+                buffer.pairs.clear();
+            }
+            jobSystem->ParallelFor(count, grainSize, [&](std::size_t begin, std::size_t end, std::size_t threadIndex) {
+                findRange(begin, end, threadBuffers[threadIndex].pairs);
+            });
+            for(const auto& buffer : threadBuffers) {
+                pairs.insert(pairs.end(), buffer.pairs.begin(), buffer.pairs.end());
+            }
+        }
+
+    private:
+        // On their own cache lines so the threads growing them do not slow each other down
+        struct alignas(64) PairBuffer {
+            std::vector<ColliderPair> pairs;
+        };
+
+        std::vector<PairBuffer> threadBuffers;
+};
+
+// Tests every pair, the reference the other broadphases are measured against
+class BruteForceBroadphase: public IBroadphase {
+    public:
+        void FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) override;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef OVERLAPKERNEL_H
+#define OVERLAPKERNEL_H
+
+#include <cstdint>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "Broadphase.h"
+
+// Colliders tested at once by ForEachOverlap
+constexpr std::uint32_t OVERLAP_BATCH_SIZE = 8;
+
+namespace overlapkernel {
+#if defined(__SSE2__)
+    // Bit k is set when the filter and the collider at + k accept each other
+    inline std::uint32_t filterMask4(const CollisionFilter& filter, const std::uint32_t* layers, const std::uint32_t* masks, std::uint32_t at) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i otherLayers = _mm_loadu_si128(reinterpret_cast<const __m128i*>(layers + at));
+        const __m128i otherMasks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + at));
+        const __m128i rejected = _mm_or_si128(
+            _mm_cmpeq_epi32(_mm_and_si128(otherLayers, _mm_set1_epi32(static_cast<int>(filter.mask))), zero),
+            _mm_cmpeq_epi32(_mm_and_si128(otherMasks, _mm_set1_epi32(static_cast<int>(filter.layer))), zero));
+        return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(rejected))) ^ 0xFu;
+    }
+#endif
+
+    template <bool IS_FILTERED, typename TCallback>
+    void forEachOverlap(const Aabb& box, const CollisionFilter& filter, const ColliderBounds& colliders, std::uint32_t first, std::uint32_t last, TCallback&& onOverlap) {
+        const float* minX = colliders.minX.data();
+        const float* minY = colliders.minY.data();
+        const float* maxX = colliders.maxX.data();
+        const float* maxY = colliders.maxY.data();
+        const std::uint32_t* layers = colliders.layers.data();
+        const std::uint32_t* masks = colliders.masks.data();
+        auto index = first;
+
+#if defined(__SSE2__)
+        const auto filterMask = [&](std::uint32_t at) {
+            if(!IS_FILTERED) {
+                return (1u << OVERLAP_BATCH_SIZE) - 1;
+            }
+            return filterMask4(filter, layers, masks, at) | filterMask4(filter, layers, masks, at + 4) << 4;
+        };
+#endif
+
+#if defined(__AVX__)
+        const __m256 boxMinX = _mm256_set1_ps(box.minX);
+        const __m256 boxMinY = _mm256_set1_ps(box.minY);
+        const __m256 boxMaxX = _mm256_set1_ps(box.maxX);
+        const __m256 boxMaxY = _mm256_set1_ps(box.maxY);
+        for(; index + OVERLAP_BATCH_SIZE <= last; index += OVERLAP_BATCH_SIZE) {
+            const __m256 overlapX = _mm256_and_ps(
+                _mm256_cmp_ps(boxMinX, _mm256_loadu_ps(maxX + index), _CMP_LE_OQ),
+                _mm256_cmp_ps(boxMaxX, _mm256_loadu_ps(minX + index), _CMP_GE_OQ));
+            const __m256 overlapY = _mm256_and_ps(
+                _mm256_cmp_ps(boxMinY, _mm256_loadu_ps(maxY + index), _CMP_LE_OQ),
+                _mm256_cmp_ps(boxMaxY, _mm256_loadu_ps(minY + index), _CMP_GE_OQ));
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_and_ps(overlapX, overlapY)));
+            // Most batches have no overlap at all, the layers are only looked at for the others
+            if(mask != 0) {
+                mask &= filterMask(index);
+            }
+            while(mask != 0) {
+                onOverlap(index + static_cast<std::uint32_t>(__builtin_ctz(mask)));
+                mask &= mask - 1;
+            }
+        }
+#elif defined(__SSE2__)
+        const __m128 boxMinX = _mm_set1_ps(box.minX);
+        const __m128 boxMinY = _mm_set1_ps(box.minY);
+        const __m128 boxMaxX = _mm_set1_ps(box.maxX);
+        const __m128 boxMaxY = _mm_set1_ps(box.maxY);
+        const auto overlapMask4 = [&](std::uint32_t at) {
+            const __m128 overlapX = _mm_and_ps(
+                _mm_cmple_ps(boxMinX, _mm_loadu_ps(maxX + at)),
+                _mm_cmpge_ps(boxMaxX, _mm_loadu_ps(minX + at)));
+            const __m128 overlapY = _mm_and_ps(
+                _mm_cmple_ps(boxMinY, _mm_loadu_ps(maxY + at)),
+                _mm_cmpge_ps(boxMaxY, _mm_loadu_ps(minY + at)));
+            return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_and_ps(overlapX, overlapY)));
+        };
+        for(; index + OVERLAP_BATCH_SIZE <= last; index += OVERLAP_BATCH_SIZE) {
+            auto mask = overlapMask4(index) | overlapMask4(index + 4) << 4;
+            // Most batches have no overlap at all, the layers are only looked at for the others
+            if(mask != 0) {
+                mask &= filterMask(index);
+            }
+            while(mask != 0) {
+                onOverlap(index + static_cast<std::uint32_t>(__builtin_ctz(mask)));
+                mask &= mask - 1;
+            }
+        }
+#endif
+
+        for(; index < last; index++) {
+            if(IS_FILTERED && ((filter.mask & layers[index]) == 0 || (masks[index] & filter.layer) == 0)) {
+                continue;
+            }
+            if((box.minX <= maxX[index]) & (box.maxX >= minX[index]) &
+               (box.minY <= maxY[index]) & (box.maxY >= minY[index])) {
+                onOverlap(index);
+            }
+        }
+    }
+}
+
+/*******************************************
+ ForEachOverlap
+******************************************
+ Calls onOverlap(index) for every collider of [first, last) the box
+ overlaps, in index order. Batches of 8 colliders are tested with one AVX
+ compare per bound, or two SSE2 ones, and only the set bits of the
+ resulting mask reach the callback. The remainder, and builds without
+ SSE2, go through the same test without branching on each bound.
+ Touching boxes overlap, as in Aabb::Overlaps
+*******************************************/
+template <typename TCallback>
+void ForEachOverlap(const Aabb& box, const ColliderBounds& colliders, std::uint32_t first, std::uint32_t last, TCallback&& onOverlap) {
+    overlapkernel::forEachOverlap<false>(box, CollisionFilter{}, colliders, first, last, onOverlap);
+}
+
+// Same, leaving out the colliders the filter does not accept
+template <typename TCallback>
+void ForEachOverlap(const Aabb& box, const CollisionFilter& filter, const ColliderBounds& colliders, std::uint32_t first, std::uint32_t last, TCallback&& onOverlap) {
+    overlapkernel::forEachOverlap<true>(box, filter, colliders, first, last, onOverlap);
+}
+
+#endif
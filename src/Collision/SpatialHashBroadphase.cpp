@@ -0,0 +1,142 @@
+#include "SpatialHashBroadphase.h"
+#include "OverlapKernel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Cell coordinates are clamped to +-2^29, far past any level yet small enough that
+    // cell spans and the binning loops stay in int32. Colliders further out share the
+    // edge cells, which only costs overlap tests, and huge ones go to the oversized list
+    constexpr float MAX_CELL_COORDINATE = 536870912.0f;
+
+    std::uint32_t hashCell(std::int32_t cellX, std::int32_t cellY) {
+        return static_cast<std::uint32_t>(cellX) * 73856093u ^ static_cast<std::uint32_t>(cellY) * 19349663u;
+    }
+}
+
+float SpatialHashBroadphase::GetCellSize() const {
+    return cellSize;
+}
+
+std::int32_t SpatialHashBroadphase::cellOf(float coordinate) const {
+    const float cell = std::floor(coordinate / cellSize);
+    // Written so NaN lands in the lowest cell rather than in the cast
+    if(!(cell > -MAX_CELL_COORDINATE)) {
+        return static_cast<std::int32_t>(-MAX_CELL_COORDINATE);
+    }
+    if(cell > MAX_CELL_COORDINATE) {
+        return static_cast<std::int32_t>(MAX_CELL_COORDINATE);
+    }
+    return static_cast<std::int32_t>(cell);
+}
+
+// Cells twice as wide as the 90th percentile of the collider extents keep most colliders
+// within 2x2 cells, without letting a few huge colliders blow up the cell size
+void SpatialHashBroadphase::updateCellSize(const ColliderBounds& colliders) {
+    extents.clear();
+    for(std::size_t i = 0; i < colliders.GetSize(); i++) {
+        extents.push_back(std::max(colliders.maxX[i] - colliders.minX[i], colliders.maxY[i] - colliders.minY[i]));
+    }
+
+    auto percentile = extents.begin() + (extents.size() * 9) / 10;
+    std::nth_element(extents.begin(), percentile, extents.end());
+    cellSize = std::max(*percentile * 2.0f, 1.0f);
+}
+
+void SpatialHashBroadphase::FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) {
+    if(colliders.GetSize() < 2) {
+        return;
+    }
+    updateCellSize(colliders);
+
+    // Bin every collider into the cells it covers
+    const auto colliderCount = static_cast<std::uint32_t>(colliders.GetSize());
+    entries.clear();
+    oversized.clear();
+    isOversized.assign(colliderCount, false);
+    for(std::uint32_t i = 0; i < colliderCount; i++) {
+        const auto bounds = colliders.GetAabb(i);
+        const auto minCellX = cellOf(bounds.minX);
+        const auto minCellY = cellOf(bounds.minY);
+        const auto maxCellX = cellOf(bounds.maxX);
+        const auto maxCellY = cellOf(bounds.maxY);
+
+        const auto cellCount = static_cast<std::size_t>(maxCellX - minCellX + 1) * static_cast<std::size_t>(maxCellY - minCellY + 1);
+        if(cellCount > MAX_CELLS_PER_COLLIDER) {
+            oversized.push_back(i);
+            isOversized[i] = true;
+            continue;
+        }
+
+        for(auto cellY = minCellY; cellY <= maxCellY; cellY++) {
+            for(auto cellX = minCellX; cellX <= maxCellX; cellX++) {
+                entries.push_back(CellEntry{bounds, colliders.GetFilter(i), cellX, cellY, i, 0});
+            }
+        }
+    }
+
+    // Counting sort of the entries by hash bucket, twice as many buckets as entries
+    std::uint32_t bucketCount = 1;
+    while(bucketCount < entries.size() * 2) {
+        bucketCount <<= 1;
+    }
+    bucketStarts.assign(bucketCount + 1, 0);
+    for(auto& entry : entries) {
+        entry.bucket = hashCell(entry.cellX, entry.cellY) & (bucketCount - 1);
+        bucketStarts[entry.bucket + 1]++;
+    }
+    for(std::uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStarts[bucket + 1] += bucketStarts[bucket];
+    }
+    sortedEntries.resize(entries.size());
+    for(const auto& entry : entries) {
+        sortedEntries[bucketStarts[entry.bucket]++] = entry;
+    }
+
+    // The scatter moved every start to the end of its bucket, so bucket b is [end(b - 1), end(b)).
+    // Buckets are independent, the threads share them out in ranges
+    findPairsInParallel(bucketCount, 4096, pairs, [&](std::size_t firstBucket, std::size_t lastBucket, std::vector<ColliderPair>& threadPairs) {
+        std::uint32_t bucketStart = firstBucket == 0 ? 0 : bucketStarts[firstBucket - 1];
+        for(auto bucket = firstBucket; bucket < lastBucket; bucket++) {
+            const auto bucketEnd = bucketStarts[bucket];
+            for(auto a = bucketStart; a < bucketEnd; a++) {
+                const auto& entryA = sortedEntries[a];
+                for(auto b = a + 1; b < bucketEnd; b++) {
+                    const auto& entryB = sortedEntries[b];
+                    // Different cells may share a bucket, and the layers may rule the pair out
+                    if(entryA.cellX != entryB.cellX || entryA.cellY != entryB.cellY || !entryA.filter.Accepts(entryB.filter)) {
+                        continue;
+                    }
+
+                    const auto& boundsA = entryA.bounds;
+                    const auto& boundsB = entryB.bounds;
+                    if(!boundsA.Overlaps(boundsB)) {
+                        continue;
+                    }
+
+                    // Two colliders can share several cells, only the cell holding the
+                    // min corner of their intersection reports them
+                    if(cellOf(std::max(boundsA.minX, boundsB.minX)) != entryA.cellX ||
+                       cellOf(std::max(boundsA.minY, boundsB.minY)) != entryA.cellY) {
+                        continue;
+                    }
+
+                    threadPairs.emplace_back(std::min(entryA.collider, entryB.collider), std::max(entryA.collider, entryB.collider));
+                }
+            }
+            bucketStart = bucketEnd;
+        }
+    });
+
+    // Oversized colliders test everything, pairs of two oversized ones are reported once
+    findPairsInParallel(oversized.size(), 8, pairs, [&](std::size_t begin, std::size_t end, std::vector<ColliderPair>& threadPairs) {
+        for(auto k = begin; k < end; k++) {
+            const auto i = oversized[k];
+            ForEachOverlap(colliders.GetAabb(i), colliders.GetFilter(i), colliders, 0, colliderCount, [&](std::uint32_t j) {
+                if(j != i && !(isOversized[j] && j < i)) {
+                    threadPairs.emplace_back(std::min(i, j), std::max(i, j));
+                }
+            });
+        }
+    });
+}
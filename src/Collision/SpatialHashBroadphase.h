@@ -0,0 +1,45 @@
+#ifndef SPATIALHASHBROADPHASE_H
+#define SPATIALHASHBROADPHASE_H
+
+#include "Broadphase.h"
+
+/*******************************************
+ SpatialHashBroadphase
+******************************************
+ Bins the colliders into a uniform grid of square cells and only tests the
+ colliders sharing a cell. The cells live in a hash table rebuilt every frame
+ with a counting sort, and their size follows the collider sizes of the frame
+*******************************************/
+class SpatialHashBroadphase: public IBroadphase {
+    public:
+        // Colliders covering more cells than this are tested against everything instead
+        static constexpr std::size_t MAX_CELLS_PER_COLLIDER = 64;
+
+        void FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) override;
+
+        float GetCellSize() const;
+
+    private:
+        // Carries a copy of the bounds so a bucket is tested without jumping around the collider list
+        struct CellEntry {
+            Aabb bounds;
+            CollisionFilter filter;
+            std::int32_t cellX;
+            std::int32_t cellY;
+            std::uint32_t collider;
+            std::uint32_t bucket;
+        };
+
+        float cellSize = 1.0f;
+        std::vector<float> extents;
+        std::vector<CellEntry> entries;
+        std::vector<CellEntry> sortedEntries;
+        std::vector<std::uint32_t> bucketStarts;
+        std::vector<std::uint32_t> oversized;
+        std::vector<char> isOversized;
+
+        void updateCellSize(const ColliderBounds& colliders);
+        std::int32_t cellOf(float coordinate) const;
+};
+
+#endif
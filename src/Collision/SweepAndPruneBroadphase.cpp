@@ -0,0 +1,95 @@
+#include "SweepAndPruneBroadphase.h"
+#include "OverlapKernel.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    constexpr std::uint32_t NOT_IN_FRAME = std::numeric_limits<std::uint32_t>::max();
+
+    // Starts come before ends at the same coordinate so touching intervals overlap, as in Aabb::Overlaps
+    template <typename TEndpoint>
+    bool endpointLess(const TEndpoint& a, const TEndpoint& b) {
+        return a.value < b.value || (a.value == b.value && !a.isMax && b.isMax);
+    }
+}
+
+// Refreshes the endpoints of the colliders still present, drops the others and appends the new ones
+void SweepAndPruneBroadphase::syncEndpoints(const ColliderBounds& colliders) {
+    const auto colliderCount = static_cast<std::uint32_t>(colliders.GetSize());
+    std::size_t maxEntityId = 0;
+    for(const auto entityId : colliders.entityIds) {
+        maxEntityId = std::max(maxEntityId, entityId);
+    }
+    frameIndexOfEntity.assign(maxEntityId + 1, NOT_IN_FRAME);
+    for(std::uint32_t i = 0; i < colliderCount; i++) {
+        frameIndexOfEntity[colliders.entityIds[i]] = i;
+    }
+
+    isTracked.assign(colliderCount, false);
+    std::size_t keptCount = 0;
+    for(auto endpoint : endpoints) {
+        const auto index = endpoint.entityId < frameIndexOfEntity.size() ? frameIndexOfEntity[endpoint.entityId] : NOT_IN_FRAME;
+        if(index == NOT_IN_FRAME) {
+            continue;
+        }
+        endpoint.value = endpoint.isMax ? colliders.maxX[index] : colliders.minX[index];
+        endpoints[keptCount++] = endpoint;
+        isTracked[index] = true;
+    }
+    endpoints.resize(keptCount);
+
+    for(std::uint32_t i = 0; i < colliderCount; i++) {
+        if(!isTracked[i]) {
+            const auto entityId = static_cast<std::uint32_t>(colliders.entityIds[i]);
+            endpoints.push_back(Endpoint{colliders.minX[i], entityId, false});
+            endpoints.push_back(Endpoint{colliders.maxX[i], entityId, true});
+        }
+    }
+
+    // Appended endpoints can be far from their place, a full sort beats insertion sort
+    // when many colliders came in at once, like on a level load
+    const auto addedCount = endpoints.size() - keptCount;
+    if(addedCount > endpoints.size() / 4) {
+        std::sort(endpoints.begin(), endpoints.end(), endpointLess<Endpoint>);
+        return;
+    }
+
+    for(std::size_t i = 1; i < endpoints.size(); i++) {
+        const auto endpoint = endpoints[i];
+        auto j = i;
+        while(j > 0 && endpointLess(endpoint, endpoints[j - 1])) {
+            endpoints[j] = endpoints[j - 1];
+            j--;
+        }
+        endpoints[j] = endpoint;
+    }
+}
+
+void SweepAndPruneBroadphase::FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) {
+    syncEndpoints(colliders);
+
+    // Every interval starting while another one is open overlaps it on x, the
+    // kernel's x test always passes and the y test decides
+    active.Clear();
+    activePosition.resize(colliders.GetSize());
+    for(const auto& endpoint : endpoints) {
+        const auto index = frameIndexOfEntity[endpoint.entityId];
+        if(endpoint.isMax) {
+            const auto position = activePosition[index];
+            active.SwapRemove(position);
+            if(position < active.GetSize()) {
+                activePosition[active.entityIds[position]] = position;
+            }
+            continue;
+        }
+
+        const auto bounds = colliders.GetAabb(index);
+        const auto filter = colliders.GetFilter(index);
+        ForEachOverlap(bounds, filter, active, 0, static_cast<std::uint32_t>(active.GetSize()), [&](std::uint32_t position) {
+            const auto other = static_cast<std::uint32_t>(active.entityIds[position]);
+            pairs.emplace_back(std::min(index, other), std::max(index, other));
+        });
+        activePosition[index] = static_cast<std::uint32_t>(active.GetSize());
+        active.Add(index, bounds, filter);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef SWEEPANDPRUNEBROADPHASE_H
+#define SWEEPANDPRUNEBROADPHASE_H
+
+#include "Broadphase.h"
+
+/*******************************************
+ SweepAndPruneBroadphase
+******************************************
+ Keeps the x interval endpoints of the colliders sorted from one frame to
+ the next. Colliders barely move between frames, so the insertion sort that
+ restores the order is close to linear. A sweep over the endpoints then
+ tests each collider against the intervals open at its start, on the y axis
+*******************************************/
+class SweepAndPruneBroadphase: public IBroadphase {
+    public:
+        void FindPairs(const ColliderBounds& colliders, std::vector<ColliderPair>& pairs) override;
+
+    private:
+        // Endpoints are tracked by entity id, the frame's collider index is looked up every frame
+        struct Endpoint {
+            float value;
+            std::uint32_t entityId;
+            bool isMax;
+        };
+
+        std::vector<Endpoint> endpoints;
+        std::vector<std::uint32_t> frameIndexOfEntity;
+        std::vector<char> isTracked;
+        // The intervals open during the sweep, their entity id slot holds the collider index
+        ColliderBounds active;
+        std::vector<std::uint32_t> activePosition;
+
+        void syncEndpoints(const ColliderBounds& colliders);
+};
+
+#endif
@@ -1,16 +1,25 @@
 #ifndef BOXCOLLIDERCOMPONENT_H
 #define BOXCOLLIDERCOMPONENT_H
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 struct BoxColliderComponent {
+    // Colliders start on the first layer and collide with every layer
+    static constexpr std::uint32_t DEFAULT_LAYER = 1u << 0;
+    static constexpr std::uint32_t ALL_LAYERS = 0xFFFFFFFFu;
+
     int width;
     int height;
     glm::vec2 offset;
+    // Bit flags of the layers the collider is on, and of the layers it collides with.
+    // Two colliders are only tested when the mask of each one has a layer of the other
+    std::uint32_t layer;
+    std::uint32_t mask;
 
-    BoxColliderComponent(int width = 0, int height = 0, glm::vec2 offset = glm::vec2(0)) :
-        width{width}, height{height}, offset{offset}
+    BoxColliderComponent(int width = 0, int height = 0, glm::vec2 offset = glm::vec2(0), std::uint32_t layer = DEFAULT_LAYER, std::uint32_t mask = ALL_LAYERS) :
+        width{width}, height{height}, offset{offset}, layer{layer}, mask{mask}
     {}
 };
 
-#endif
\ No newline at end of file
+#endif
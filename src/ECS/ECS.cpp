@@ -1,8 +1,50 @@
 #include "ECS.h"
 #include "../Logger/Logger.h"
 #include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <stdexcept>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
 
-std::size_t IComponent::nextId = 0;
+std::atomic<std::size_t> IComponent::nextId{0};
+std::atomic<std::size_t> Registry::nextSerial{0};
+std::atomic<std::uint64_t> Registry::nextGeneration{1};
+std::array<ComponentInfo, MAX_COMPONENTS> IComponent::infos;
+
+std::string DemangleTypeName(const char* mangledName) {
+#if defined(__GNUG__)
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(mangledName, nullptr, nullptr, &status);
+    if(status == 0 && demangled) {
+        std::string name{demangled};
+        std::free(demangled);
+        return name;
+    }
+#endif
+    return mangledName;
+}
+
+std::size_t IComponent::Register(ComponentInfo info) {
+    // Only takes the id once it is known to fit, so nextId never passes MAX_COMPONENTS
+    auto id = nextId.load();
+    do {
+        if(id >= MAX_COMPONENTS) {
+            throw std::length_error("Too many component types, MAX_COMPONENTS is " + std::to_string(MAX_COMPONENTS));
+        }
+    } while(!nextId.compare_exchange_weak(id, id + 1));
+    infos[id] = std::move(info);
+    return id;
+}
+
+const ComponentInfo& IComponent::GetInfo(std::size_t componentId) {
+    return infos[componentId];
+}
+
+std::size_t IComponent::GetCount() {
+    return nextId;
+}
 
 std::size_t Entity::GetId() const {
     return id;
@@ -12,6 +54,22 @@ void Entity::Kill() {
     registry->KillEntity(*this);
 }
 
+void Entity::Group(const std::string& group) {
+    registry->GroupEntity(*this, group);
+}
+
+bool Entity::BelongsToGroup(const std::string& group) const {
+    return registry->EntityBelongsToGroup(*this, group);
+}
+
+std::size_t Entity::GetGroupId() const {
+    return registry->GetEntityGroupId(*this);
+}
+
+std::uint64_t Entity::GetGeneration() const {
+    return registry->GetEntityGeneration(*this);
+}
+
 void System::AddEntityToSystem(Entity entity) {
     entities.push_back(entity);
 }
@@ -28,6 +86,10 @@ void System::RemoveEntityFromSystem(Entity entity) {
     );
 }
 
+void System::ClearEntities() {
+    entities.clear();
+}
+
 std::vector<Entity>& System::GetSystemEntities() {
     return entities;
 }
@@ -40,57 +102,251 @@ const Signature& System::GetComponentSignature() const {
     return componentSignature;
 }
 
+std::size_t Registry::ReserveEntityId() {
+    // Reuse an id from the list of previously removed entities
+    const auto freeIndex = nextFreeId.fetch_add(1, std::memory_order_relaxed);
+    if(freeIndex < freeIds.size()) {
+        return freeIds[freeIndex];
+    }
+
+    // if there are no free ids waiting to be reused
+    return numEntities.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Slots of the registries alive, shared by every thread. Built on first use
+// so they outlive any registry, static ones included
+struct RegistrySlots {
+    std::mutex mutex;
+    std::vector<std::size_t> freeSlots;
+    std::size_t count = 0;
+};
+
+static RegistrySlots& GetRegistrySlots() {
+    static RegistrySlots slots;
+    return slots;
+}
+
+std::size_t Registry::AcquireSlot() {
+    auto& slots = GetRegistrySlots();
+    std::lock_guard<std::mutex> lock(slots.mutex);
+    if(slots.freeSlots.empty()) {
+        return slots.count++;
+    }
+    const auto slot = slots.freeSlots.back();
+    slots.freeSlots.pop_back();
+    return slot;
+}
+
+void Registry::ReleaseSlot(std::size_t slot) {
+    auto& slots = GetRegistrySlots();
+    std::lock_guard<std::mutex> lock(slots.mutex);
+    slots.freeSlots.push_back(slot);
+}
+
+Registry::SpawnBuffer& Registry::GetThreadSpawnBuffer() {
+    // Serial and buffer of the registry last seen in each slot. An entry left
+    // by a destroyed registry is overwritten by the next one getting its slot
+    thread_local std::vector<std::pair<std::size_t, SpawnBuffer*>> threadBuffers;
+
+    if(slot < threadBuffers.size() && threadBuffers[slot].second && threadBuffers[slot].first == serial) {
+        return *threadBuffers[slot].second;
+    }
+    if(slot >= threadBuffers.size()) {
+        threadBuffers.resize(slot + 1, {0, nullptr});
+    }
+
+    std::lock_guard<std::mutex> lock(spawnBuffersMutex);
+    spawnBuffers.push_back(std::make_unique<SpawnBuffer>());
+    threadBuffers[slot] = {serial, spawnBuffers.back().get()};
+    return *spawnBuffers.back();
+}
+
 Entity Registry::CreateEntity() {
-    std::size_t entityId;
-    
-    if(freeIds.empty()) {
-        // if there are no free ids waiting to be reused
-        entityId = numEntities++;
+    const auto entityId = ReserveEntityId();
+
+    Entity entity(entityId);
+    entity.registry = this;
+
+    if(std::this_thread::get_id() == ownerThread) {
         if(entityId >= entityComponentSignatures.size()) {
             entityComponentSignatures.resize(entityId + 1);
+            entityGenerations.resize(entityId + 1, 0);
         }
+        entityGenerations[entityId] = nextGeneration++;
+        entitiesToBeAdded.insert(entity);
     } else {
-        // Reuse and id from the list of previously remove entities
-        entityId = freeIds.front();
-        freeIds.pop_front();
+        GetThreadSpawnBuffer().entityIds.push_back(entityId);
     }
 
-    Entity entity(entityId);
-    entity.registry = this;
-    entitiesToBeAdded.insert(entity);
-
-    Logger::Log("Entity created with id = " + std::to_string(entityId));
+    LOG_TRACE(LogCategory::ECS, "Entity created with id = {}", entityId);
     
     return entity;
 }
 
+void Registry::CollectSpawnedEntities() {
+    std::lock_guard<std::mutex> lock(spawnBuffersMutex);
+    if(entityComponentSignatures.size() < numEntities) {
+        entityComponentSignatures.resize(numEntities);
+        entityGenerations.resize(numEntities, 0);
+    }
+
+    for(auto& buffer: spawnBuffers) {
+        for(auto id: buffer->entityIds) {
+            Entity entity(id);
+            entity.registry = this;
+            entityGenerations[id] = nextGeneration++;
+            entitiesToBeAdded.insert(entity);
+        }
+        buffer->entityIds.clear();
+    }
+
+    // Only once every spawned id has its signature slot
+    for(auto& buffer: spawnBuffers) {
+        for(auto& addComponent: buffer->componentAdds) {
+            addComponent();
+        }
+        buffer->componentAdds.clear();
+    }
+}
+
+void Registry::CompactFreeIds() {
+    const auto handedOut = std::min<std::size_t>(nextFreeId, freeIds.size());
+    freeIds.erase(freeIds.begin(), freeIds.begin() + handedOut);
+    nextFreeId = 0;
+}
+
+std::vector<bool> Registry::GetFreeIdMask() const {
+    std::vector<bool> isFree(numEntities, false);
+    for(auto i = std::min<std::size_t>(nextFreeId, freeIds.size()); i < freeIds.size(); i++) {
+        isFree[freeIds[i]] = true;
+    }
+    return isFree;
+}
+
+Entity Registry::CloneEntity(Entity entity) {
+    assert(std::this_thread::get_id() == ownerThread && "CloneEntity() must run on the owner thread");
+    const auto sourceId = entity.GetId();
+    Entity clone = CreateEntity();
+    const auto cloneId = clone.GetId();
+    const auto signature = entityComponentSignatures[sourceId];
+
+    for(std::size_t componentId = 0; componentId < componentPools.size(); componentId++) {
+        if(!signature.test(componentId)) {
+            continue;
+        }
+
+        auto& pool = componentPools[componentId];
+        if(cloneId >= pool->GetSize()) {
+            pool->Resize(numEntities);
+        }
+
+        const auto& info = IComponent::GetInfo(componentId);
+        void* dst = pool->GetElement(cloneId);
+        const void* src = pool->GetElement(sourceId);
+        if(info.isTriviallyCopyable) {
+            std::memcpy(dst, src, info.size);
+        } else {
+            info.assign(dst, src);
+        }
+    }
+    entityComponentSignatures[cloneId] = signature;
+
+    auto grouped = groupPerEntityId.find(sourceId);
+    if(grouped != groupPerEntityId.end()) {
+        const auto group = grouped->second;
+        GroupEntity(clone, group);
+    }
+
+    return clone;
+}
+
 void Registry::KillEntity(Entity entity) {
     entitiesToBeKilled.insert(entity);
 }
 
+void Registry::IndexSystem(std::shared_ptr<System> system) {
+    auto freeSlot = std::find(systemsByIndex.begin(), systemsByIndex.end(), nullptr);
+    const std::size_t systemIndex = freeSlot - systemsByIndex.begin();
+    if(systemIndex >= MAX_SYSTEMS) {
+        throw std::length_error("Too many systems, MAX_SYSTEMS is " + std::to_string(MAX_SYSTEMS));
+    }
+
+    const auto& signature = system->GetComponentSignature();
+    if(signature.none()) {
+        systemsWithoutRequirements.set(systemIndex);
+    }
+    ForEachSetBit(signature, [this, systemIndex](std::size_t componentId) {
+        systemsPerComponent[componentId].set(systemIndex);
+    });
+
+    if(freeSlot == systemsByIndex.end()) {
+        systemsByIndex.push_back(std::move(system));
+    } else {
+        *freeSlot = std::move(system);
+    }
+}
+
+void Registry::UnindexSystem(const std::shared_ptr<System>& system) {
+    auto slot = std::find(systemsByIndex.begin(), systemsByIndex.end(), system);
+    const std::size_t systemIndex = slot - systemsByIndex.begin();
+
+    systemsWithoutRequirements.reset(systemIndex);
+    for(auto& interestedSystems: systemsPerComponent) {
+        interestedSystems.reset(systemIndex);
+    }
+    for(auto& memberships: entitySystemMemberships) {
+        memberships.reset(systemIndex);
+    }
+    *slot = nullptr;
+}
+
 void Registry::AddEntityToSystems(Entity entity) {
     const auto entityId = entity.GetId();
 
     const auto entityComponentSignature = entityComponentSignatures[entityId];
 
-    // loop all the systems
-    for(auto& system: systems) {
-        const auto& systemComponentSignature = system.second->GetComponentSignature();
+    if(entityId >= entitySystemMemberships.size()) {
+        entitySystemMemberships.resize(entityId + 1);
+    }
+    auto& memberships = entitySystemMemberships[entityId];
+
+    // Only the systems requiring one of the entity components (or none at all)
+    // can be interested, skip the ones the entity is already in
+    SystemMask candidates = systemsWithoutRequirements;
+    ForEachSetBit(entityComponentSignature, [this, &candidates](std::size_t componentId) {
+        candidates |= systemsPerComponent[componentId];
+    });
+    candidates &= ~memberships;
+
+    ForEachSetBit(candidates, [&](std::size_t systemIndex) {
+        const auto& system = systemsByIndex[systemIndex];
+        const auto& systemComponentSignature = system->GetComponentSignature();
 
         bool isInterested = (entityComponentSignature & systemComponentSignature) == systemComponentSignature;
         if(isInterested) {
-            system.second->AddEntityToSystem(entity);
+            system->AddEntityToSystem(entity);
+            memberships.set(systemIndex);
         }
-    }
+    });
 }
 
 void Registry::RemoveEntityFromSystems(Entity entity) {
-    for(auto& system: systems) {
-        system.second->RemoveEntityFromSystem(entity);
+    const auto entityId = entity.GetId();
+    if(entityId >= entitySystemMemberships.size()) {
+        return;
     }
+
+    auto& memberships = entitySystemMemberships[entityId];
+    ForEachSetBit(memberships, [this, entity](std::size_t systemIndex) {
+        systemsByIndex[systemIndex]->RemoveEntityFromSystem(entity);
+    });
+    memberships.reset();
 }
 
 void Registry::Update() {
+    CollectSpawnedEntities();
+    CompactFreeIds();
+
     // Add the entities that are waiting to be
     // created to the active systems
     for(auto entity: entitiesToBeAdded) {
@@ -104,9 +360,273 @@ void Registry::Update() {
         RemoveEntityFromSystems(entity);
         
         entityComponentSignatures[entity.GetId()].reset();
+        entityGenerations[entity.GetId()] = 0;
+        RemoveEntityGroup(entity);
 
         // Make the entity id available to be reused
         freeIds.push_back(entity.GetId());
     }
     entitiesToBeKilled.clear();
-}
\ No newline at end of file
+}
+
+std::vector<std::size_t> Registry::GetLivingEntityIds() const {
+    auto isDead = GetFreeIdMask();
+    for(auto entity: entitiesToBeKilled) {
+        isDead[entity.GetId()] = true;
+    }
+
+    std::vector<std::size_t> livingIds;
+    for(std::size_t id = 0; id < numEntities; id++) {
+        if(!isDead[id]) {
+            livingIds.push_back(id);
+        }
+    }
+    return livingIds;
+}
+
+void Registry::RequeueEntitiesToSystems() {
+    for(auto& system: systems) {
+        system.second->ClearEntities();
+    }
+    entitySystemMemberships.clear();
+
+    // The pending sets may hold entities pointing to another registry
+    std::set<Entity> killed;
+    for(auto entity: entitiesToBeKilled) {
+        Entity requeued(entity.GetId());
+        requeued.registry = this;
+        killed.insert(requeued);
+    }
+    entitiesToBeKilled.swap(killed);
+
+    entitiesToBeAdded.clear();
+    for(auto id: GetLivingEntityIds()) {
+        Entity entity(id);
+        entity.registry = this;
+        entitiesToBeAdded.insert(entity);
+    }
+}
+
+std::vector<std::size_t> Registry::Merge(Registry& other) {
+    assert(std::this_thread::get_id() == ownerThread && "Merge() must run on the owner thread");
+    other.CollectSpawnedEntities();
+    std::vector<std::size_t> newIds(other.numEntities, INVALID_ENTITY_ID);
+
+    for(auto oldId: other.GetLivingEntityIds()) {
+        Entity entity = CreateEntity();
+        const auto newId = entity.GetId();
+        const auto& signature = other.entityComponentSignatures[oldId];
+
+        for(std::size_t componentId = 0; componentId < other.componentPools.size(); componentId++) {
+            if(!signature.test(componentId)) {
+                continue;
+            }
+
+            const auto& otherPool = other.componentPools[componentId];
+            if(componentId >= componentPools.size()) {
+                componentPools.resize(componentId + 1, nullptr);
+            }
+            if(!componentPools[componentId]) {
+                componentPools[componentId] = otherPool->CreateEmpty();
+            }
+            componentPools[componentId]->MoveFrom(*otherPool, oldId, newId);
+        }
+
+        entityComponentSignatures[newId] = signature;
+        newIds[oldId] = newId;
+    }
+
+    for(const auto& grouped: other.groupPerEntityId) {
+        if(newIds[grouped.first] != INVALID_ENTITY_ID) {
+            Entity entity(newIds[grouped.first]);
+            entity.registry = this;
+            GroupEntity(entity, grouped.second);
+        }
+    }
+
+    // Leave other as an empty world
+    other.Clear();
+
+    LOG_DEBUG(LogCategory::ECS, "Merged {} entity ids into the registry", newIds.size());
+
+    return newIds;
+}
+
+void Registry::Swap(Registry& other) {
+    CollectSpawnedEntities();
+    other.CollectSpawnedEntities();
+    CompactFreeIds();
+    other.CompactFreeIds();
+
+    numEntities = other.numEntities.exchange(numEntities);
+    componentPools.swap(other.componentPools);
+    entityComponentSignatures.swap(other.entityComponentSignatures);
+    entityGenerations.swap(other.entityGenerations);
+    entitiesToBeAdded.swap(other.entitiesToBeAdded);
+    entitiesToBeKilled.swap(other.entitiesToBeKilled);
+    freeIds.swap(other.freeIds);
+    entityIdsPerGroup.swap(other.entityIdsPerGroup);
+    groupPerEntityId.swap(other.groupPerEntityId);
+    groupIdPerEntityId.swap(other.groupIdPerEntityId);
+
+    RequeueEntitiesToSystems();
+    other.RequeueEntitiesToSystems();
+
+    LOG_DEBUG(LogCategory::ECS, "Registry swapped, {} entity ids are now live", numEntities.load());
+}
+
+void Registry::Clear() {
+    for(auto& pool: componentPools) {
+        if(pool) {
+            pool->Clear();
+        }
+    }
+    for(auto& system: systems) {
+        system.second->ClearEntities();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(spawnBuffersMutex);
+        for(auto& buffer: spawnBuffers) {
+            buffer->entityIds.clear();
+            buffer->componentAdds.clear();
+        }
+    }
+
+    numEntities = 0;
+    entityComponentSignatures.clear();
+    entityGenerations.clear();
+    entitySystemMemberships.clear();
+    entitiesToBeAdded.clear();
+    entitiesToBeKilled.clear();
+    freeIds.clear();
+    nextFreeId = 0;
+    entityIdsPerGroup.clear();
+    groupPerEntityId.clear();
+    groupIdPerEntityId.clear();
+
+    LOG_DEBUG(LogCategory::ECS, "Registry cleared");
+}
+
+void Registry::KillAllWithSignature(const Signature& signature) {
+    CollectSpawnedEntities();
+    const auto isFree = GetFreeIdMask();
+
+    std::vector<bool> isKilled(numEntities, false);
+    for(std::size_t id = 0; id < numEntities; id++) {
+        isKilled[id] = !isFree[id] && (entityComponentSignatures[id] & signature) == signature;
+    }
+
+    KillEntitiesInBulk(isKilled);
+}
+
+void Registry::KillGroup(const std::string& group) {
+    auto groupIt = entityIdsPerGroup.find(group);
+    if(groupIt == entityIdsPerGroup.end()) {
+        return;
+    }
+
+    std::vector<bool> isKilled(numEntities, false);
+    for(auto id: groupIt->second) {
+        isKilled[id] = true;
+    }
+
+    KillEntitiesInBulk(isKilled);
+}
+
+void Registry::KillEntitiesInBulk(const std::vector<bool>& isKilled) {
+    CollectSpawnedEntities();
+    CompactFreeIds();
+
+    auto wasKilled = [&isKilled](const Entity& entity) {
+        return entity.GetId() < isKilled.size() && isKilled[entity.GetId()];
+    };
+
+    // One pass per system holding killed entities instead of one per killed entity
+    SystemMask touchedSystems;
+    for(std::size_t id = 0; id < isKilled.size() && id < entitySystemMemberships.size(); id++) {
+        if(isKilled[id]) {
+            touchedSystems |= entitySystemMemberships[id];
+            entitySystemMemberships[id].reset();
+        }
+    }
+    ForEachSetBit(touchedSystems, [this, &wasKilled](std::size_t systemIndex) {
+        auto& entities = systemsByIndex[systemIndex]->GetSystemEntities();
+        entities.erase(std::remove_if(entities.begin(), entities.end(), wasKilled), entities.end());
+    });
+
+    for(auto pending: {&entitiesToBeAdded, &entitiesToBeKilled}) {
+        for(auto it = pending->begin(); it != pending->end();) {
+            it = wasKilled(*it) ? pending->erase(it) : std::next(it);
+        }
+    }
+
+    std::size_t killedCount = 0;
+    for(std::size_t id = 0; id < isKilled.size(); id++) {
+        if(!isKilled[id]) {
+            continue;
+        }
+        entityComponentSignatures[id].reset();
+        entityGenerations[id] = 0;
+        RemoveEntityGroup(Entity(id));
+        freeIds.push_back(id);
+        killedCount++;
+    }
+
+    LOG_DEBUG(LogCategory::ECS, "{} entities killed in bulk", killedCount);
+}
+
+void Registry::GroupEntity(Entity entity, const std::string& group) {
+    RemoveEntityGroup(entity);
+    entityIdsPerGroup[group].insert(entity.GetId());
+    groupPerEntityId.emplace(entity.GetId(), group);
+
+    if(entity.GetId() >= groupIdPerEntityId.size()) {
+        groupIdPerEntityId.resize(entity.GetId() + 1, NO_GROUP_ID);
+    }
+    groupIdPerEntityId[entity.GetId()] = GetGroupId(group);
+}
+
+bool Registry::EntityBelongsToGroup(Entity entity, const std::string& group) const {
+    auto grouped = groupPerEntityId.find(entity.GetId());
+    return grouped != groupPerEntityId.end() && grouped->second == group;
+}
+
+std::vector<Entity> Registry::GetEntitiesByGroup(const std::string& group) {
+    std::vector<Entity> entities;
+    auto groupIt = entityIdsPerGroup.find(group);
+    if(groupIt != entityIdsPerGroup.end()) {
+        for(auto id: groupIt->second) {
+            Entity entity(id);
+            entity.registry = this;
+            entities.push_back(entity);
+        }
+    }
+    return entities;
+}
+
+void Registry::RemoveEntityGroup(Entity entity) {
+    auto grouped = groupPerEntityId.find(entity.GetId());
+    if(grouped != groupPerEntityId.end()) {
+        entityIdsPerGroup[grouped->second].erase(entity.GetId());
+        groupPerEntityId.erase(grouped);
+        groupIdPerEntityId[entity.GetId()] = NO_GROUP_ID;
+    }
+}
+
+std::size_t Registry::GetGroupId(const std::string& group) {
+    // Shared by the registries of every thread, only looked up when grouping or subscribing
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::size_t> groupIds;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return groupIds.emplace(group, groupIds.size()).first->second;
+}
+
+std::size_t Registry::GetEntityGroupId(Entity entity) const {
+    return entity.GetId() < groupIdPerEntityId.size() ? groupIdPerEntityId[entity.GetId()] : NO_GROUP_ID;
+}
+
+std::uint64_t Registry::GetEntityGeneration(Entity entity) const {
+    return entity.GetId() < entityGenerations.size() ? entityGenerations[entity.GetId()] : 0;
+}
@@ -5,14 +5,27 @@
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
+#include <typeinfo>
 #include <set>
-#include <deque>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <string>
 #include <memory>
 #include <functional>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <ostream>
+#include <type_traits>
 #include "../Logger/Logger.h"
 
 constexpr unsigned int MAX_COMPONENTS = 32;
+constexpr unsigned int MAX_SYSTEMS = 64;
 
 //////////////////////////////////////////
 // Signature
@@ -22,9 +35,80 @@ constexpr unsigned int MAX_COMPONENTS = 32;
 /////////////////////////////////////////////
 using Signature = std::bitset<MAX_COMPONENTS>;
 
+// One bit per system index, e.g. the systems an entity belongs to
+using SystemMask = std::bitset<MAX_SYSTEMS>;
+
+// Calls f with the index of every set bit, lowest first
+template <std::size_t N, typename F>
+void ForEachSetBit(const std::bitset<N>& bits, F&& f) {
+    static_assert(N <= 64, "ForEachSetBit works on bitsets of up to 64 bits");
+    auto word = bits.to_ullong();
+    while(word) {
+        f(static_cast<std::size_t>(__builtin_ctzll(word)));
+        word &= word - 1;
+    }
+}
+
+// Marks an entity id that has no counterpart, e.g. in the id table returned by Registry::Merge()
+constexpr std::size_t INVALID_ENTITY_ID = std::numeric_limits<std::size_t>::max();
+
+// Group id of the entities that belong to no group, see Registry::GetGroupId()
+constexpr std::size_t NO_GROUP_ID = std::numeric_limits<std::size_t>::max();
+
+//////////////////////////////////////////
+// ComponentInfo
+/////////////////////////////////////////////
+// Type-erased description of a component type, kept per component id so
+// generic code (snapshots, prefab cloning, inspectors...) can work on any pool.
+// Trivially copyable components can be copied and moved with memcpy.
+/////////////////////////////////////////////
+struct ComponentInfo {
+    std::string name;
+    std::size_t size = 0;
+    std::size_t alignment = 0;
+    bool isTriviallyCopyable = false;
+
+    // Copy/move construct the component into uninitialized memory at dst
+    void (*copy)(void* dst, const void* src) = nullptr;
+    void (*move)(void* dst, void* src) = nullptr;
+    void (*destroy)(void* component) = nullptr;
+    // Copy assigns src to the live component at dst
+    void (*assign)(void* dst, const void* src) = nullptr;
+
+    // Writes the component in binary form, nullptr when the component is
+    // neither trivially copyable nor provides a Serialize(std::ostream&) method
+    void (*serialize)(const void* component, std::ostream& out) = nullptr;
+};
+
+template <typename T, typename = void>
+struct HasSerializeMethod : std::false_type {};
+
+template <typename T>
+struct HasSerializeMethod<T, std::void_t<decltype(std::declval<const T&>().Serialize(std::declval<std::ostream&>()))>> : std::true_type {};
+
+template <typename T>
+ComponentInfo MakeComponentInfo();
+
+// Readable type name out of typeid(T).name()
+std::string DemangleTypeName(const char* mangledName);
+
 struct IComponent {
+    public:
+        // Metadata of the component type with the given id
+        static const ComponentInfo& GetInfo(std::size_t componentId);
+
+        // Number of component types that got an id so far
+        static std::size_t GetCount();
+
     protected:
-        static std::size_t nextId;
+        // Atomic so registries built on worker threads can meet a component type first
+        static std::atomic<std::size_t> nextId;
+
+        // Fixed size so registering a type never moves the infos of other types
+        static std::array<ComponentInfo, MAX_COMPONENTS> infos;
+
+        // Assigns the next id to a component type and stores its metadata
+        static std::size_t Register(ComponentInfo info);
 };
 
 // Used to assign a unique id to a component type
@@ -33,11 +117,43 @@ class Component : public IComponent {
     public:
         // Returns the unique id of Component<T>
         static std::size_t GetId() {
-            static auto id = nextId++;
+            static auto id = Register(MakeComponentInfo<T>());
             return id;
         }
 };
 
+template <typename T>
+ComponentInfo MakeComponentInfo() {
+    ComponentInfo info;
+    info.name = DemangleTypeName(typeid(T).name());
+    info.size = sizeof(T);
+    info.alignment = alignof(T);
+    info.isTriviallyCopyable = std::is_trivially_copyable<T>::value;
+    info.copy = [](void* dst, const void* src) { new (dst) T(*static_cast<const T*>(src)); };
+    info.move = [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); };
+    info.destroy = [](void* component) { static_cast<T*>(component)->~T(); };
+    if constexpr (std::is_copy_assignable<T>::value) {
+        info.assign = [](void* dst, const void* src) { *static_cast<T*>(dst) = *static_cast<const T*>(src); };
+    } else {
+        // No way around rebuilding it, dst is lost if the copy throws
+        info.assign = [](void* dst, const void* src) {
+            static_cast<T*>(dst)->~T();
+            new (dst) T(*static_cast<const T*>(src));
+        };
+    }
+
+    if constexpr (HasSerializeMethod<T>::value) {
+        info.serialize = [](const void* component, std::ostream& out) {
+            static_cast<const T*>(component)->Serialize(out);
+        };
+    } else if constexpr (std::is_trivially_copyable<T>::value) {
+        info.serialize = [](const void* component, std::ostream& out) {
+            out.write(static_cast<const char*>(component), sizeof(T));
+        };
+    }
+    return info;
+}
+
 class Entity {
     private:
         std::size_t id;
@@ -46,6 +162,9 @@ class Entity {
         void Kill();
         std::size_t GetId() const;
 
+        // Changes whenever the id is given to a new entity, 0 once it is killed
+        std::uint64_t GetGeneration() const;
+
         Entity& operator =(const Entity& other) = default;
         bool operator ==(const Entity& other) const { return id == other.id; };
         bool operator !=(const Entity& other) const { return id != other.id; };
@@ -64,9 +183,13 @@ class Entity {
         template <typename TComponent>
         TComponent& GetComponent() const;
 
+        // Groups
+        void Group(const std::string& group);
+        bool BelongsToGroup(const std::string& group) const;
+        std::size_t GetGroupId() const;
 
         // Hold a pointer to the entity's owner registry
-        class Registry* registry;
+        class Registry* registry = nullptr;
 };
 
 /*******************************************
@@ -89,6 +212,7 @@ class System {
 
         void AddEntityToSystem(Entity entity);
         void RemoveEntityFromSystem(Entity entity);
+        void ClearEntities();
         std::vector<Entity>& GetSystemEntities();
         const Signature& GetComponentSignature() const;
 
@@ -112,6 +236,24 @@ void System::RequireComponent() {
 class IPool {
     public:
         virtual ~IPool() {}
+
+        // Creates an empty pool of the same component type
+        virtual std::shared_ptr<IPool> CreateEmpty() const = 0;
+
+        // Moves the component at srcIndex of other, which must be a pool
+        // of the same component type, into dstIndex of this pool
+        virtual void MoveFrom(IPool& other, std::size_t srcIndex, std::size_t dstIndex) = 0;
+
+        // Drops every component of the pool at once
+        virtual void Clear() = 0;
+
+        // Component type of the pool, its metadata is IComponent::GetInfo(GetComponentId())
+        virtual std::size_t GetComponentId() const = 0;
+
+        // Number of slots and raw access to the component stored at index
+        virtual std::size_t GetSize() const = 0;
+        virtual void Resize(int n) = 0;
+        virtual void* GetElement(std::size_t index) = 0;
 };
 
 template <typename T>
@@ -126,19 +268,39 @@ class Pool: public IPool {
 
         virtual ~Pool() = default;
 
+        std::shared_ptr<IPool> CreateEmpty() const override {
+            return std::make_shared<Pool<T>>();
+        }
+
+        void MoveFrom(IPool& other, std::size_t srcIndex, std::size_t dstIndex) override {
+            auto& source = static_cast<Pool<T>&>(other);
+            if(dstIndex >= data.size()) {
+                data.resize(dstIndex + 1);
+            }
+            data[dstIndex] = std::move(source.data[srcIndex]);
+        }
+
         bool isEmpty() const {
             return data.empty();
         }
 
-        std::size_t GetSize() const {
+        std::size_t GetComponentId() const override {
+            return Component<T>::GetId();
+        }
+
+        std::size_t GetSize() const override {
             return data.size();
         }
 
-        void Resize(int n) {
+        void Resize(int n) override {
             data.resize(n);
         }
 
-        void Clear() {
+        void* GetElement(std::size_t index) override {
+            return &data[index];
+        }
+
+        void Clear() override {
             data.clear();
         }
 
@@ -167,7 +329,14 @@ class Pool: public IPool {
 ////////////////////////////////////////////////////
 class Registry {
     private:
-        std::size_t numEntities = 0;
+        // Ids are reserved atomically so CreateEntity() can run on any thread
+        std::atomic<std::size_t> numEntities{0};
+
+        // Generation of the entity holding each id, taken from a counter shared
+        // by every registry so ids moved around by Swap() get new ones too
+        // [ Vector index = entity id ]
+        std::vector<std::uint64_t> entityGenerations;
+        static std::atomic<std::uint64_t> nextGeneration;
 
         // Vector of component pools, each pool contains all the
         // data for a certain component type
@@ -181,13 +350,83 @@ class Registry {
 
         std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
 
+        // Systems by dense index (nullptr once removed), the systems requiring
+        // each component and the ones requiring none, so signature changes only
+        // visit the systems that can be interested
+        std::vector<std::shared_ptr<System>> systemsByIndex;
+        std::array<SystemMask, MAX_COMPONENTS> systemsPerComponent;
+        SystemMask systemsWithoutRequirements;
+
+        // Systems each entity was added to
+        // [ Vector index = entity id ]
+        std::vector<SystemMask> entitySystemMemberships;
+
+        void IndexSystem(std::shared_ptr<System> system);
+        void UnindexSystem(const std::shared_ptr<System>& system);
+
         // Set of entities that are flagged to be added or removed the
         // next registry Update()
         std::set<Entity> entitiesToBeAdded;
         std::set<Entity> entitiesToBeKilled;
 
-        // List of free entity ids that were previously removed
-        std::deque<int> freeIds;
+        // List of free entity ids that were previously removed. CreateEntity()
+        // hands its ids out by bumping nextFreeId and only reads the list, which
+        // is rewritten at the sync points alone: Update(), the bulk kills, Merge(),
+        // Swap() and Clear(). Spawning threads must not overlap any of them
+        std::vector<std::size_t> freeIds;
+        std::atomic<std::size_t> nextFreeId{0};
+
+        // Entities created from threads other than the owner one, and the
+        // components added to them there, wait in a buffer of their thread
+        // until the next sync point registers them
+        struct SpawnBuffer {
+            std::vector<std::size_t> entityIds;
+            std::vector<std::function<void()>> componentAdds;
+        };
+        std::thread::id ownerThread = std::this_thread::get_id();
+        // Index of the registry in the thread local spawn buffer tables. Slots
+        // are reused once their registry is destroyed, so the tables only grow
+        // to the most registries alive at once; the serial tells a reused slot
+        // from the registry that held it before
+        const std::size_t serial = nextSerial++;
+        const std::size_t slot = AcquireSlot();
+        static std::atomic<std::size_t> nextSerial;
+        static std::size_t AcquireSlot();
+        static void ReleaseSlot(std::size_t slot);
+        // Only locked the first time a thread creates entities in this registry
+        std::mutex spawnBuffersMutex;
+        std::vector<std::unique_ptr<SpawnBuffer>> spawnBuffers;
+
+        std::size_t ReserveEntityId();
+        SpawnBuffer& GetThreadSpawnBuffer();
+
+        // Moves the entities created by other threads to entitiesToBeAdded
+        // and adds the components they were given there
+        void CollectSpawnedEntities();
+
+        // Drops the free ids handed out since they were last compacted
+        void CompactFreeIds();
+
+        // Flags the ids that are free to be reused
+        std::vector<bool> GetFreeIdMask() const;
+
+        // Entity ids per group name, and the group of each grouped entity id
+        std::unordered_map<std::string, std::set<std::size_t>> entityIdsPerGroup;
+        std::unordered_map<std::size_t, std::string> groupPerEntityId;
+        // Group id of every entity, NO_GROUP_ID when it has none
+        // [ Vector index = entity id ]
+        std::vector<std::size_t> groupIdPerEntityId;
+
+        // Kills at once every entity flagged in isKilled, skipping entitiesToBeKilled
+        // and the per-entity RemoveEntityFromSystems()
+        void KillEntitiesInBulk(const std::vector<bool>& isKilled);
+
+        // Ids of the entities that are alive and not waiting to be killed
+        std::vector<std::size_t> GetLivingEntityIds() const;
+
+        // Empties the systems and queues every living entity to be added
+        // to them again on the next Update()
+        void RequeueEntitiesToSystems();
 
     public:
         Registry() {
@@ -195,6 +434,7 @@ class Registry {
         }
 
         ~Registry() {
+            ReleaseSlot(slot);
             Logger::Log("Registry destructor called.");
         }
 
@@ -203,9 +443,62 @@ class Registry {
         void Update();
 
         // Entity management
+        // CreateEntity() may be called from any thread, as long as the calls do
+        // not overlap the sync points (Update(), KillGroup(), KillAllWithSignature(),
+        // Merge(), Swap() and Clear()), which the owner thread runs once the
+        // spawners are done. AddComponent() from the thread that created an
+        // entity outside the owner one is deferred to the next sync point, the
+        // other component calls only see the entity after it
         Entity CreateEntity();
         void KillEntity(Entity entity);
-        
+
+        // Generation of the entity holding the id, 0 when the id is free. Lets
+        // what keeps an id around (e.g. an event subscription) notice the entity
+        // it meant was killed and the id reused
+        std::uint64_t GetEntityGeneration(Entity entity) const;
+
+        // World management
+        // A registry can be filled on a worker thread (e.g. while a level loads)
+        // and then brought into the live registry on the main thread.
+
+        // Moves every living entity of other into this registry with new ids,
+        // other is left empty. Returns a table indexed by the old entity id
+        // holding the new id (INVALID_ENTITY_ID for ids that were not alive).
+        // Owner thread only
+        std::vector<std::size_t> Merge(Registry& other);
+
+        // Exchanges the entities and components of both registries, the systems
+        // stay where they are and pick up their new entities on the next Update()
+        void Swap(Registry& other);
+
+        // Bulk kills
+        // They take effect immediately instead of on the next Update(), and
+        // reset the system lists once instead of once per killed entity.
+
+        // Drops every entity, component and group, keeping the systems
+        void Clear();
+
+        // Kills every entity owning at least the components of signature
+        void KillAllWithSignature(const Signature& signature);
+
+        // Kills every entity of the group
+        void KillGroup(const std::string& group);
+
+        // Group management
+        void GroupEntity(Entity entity, const std::string& group);
+        bool EntityBelongsToGroup(Entity entity, const std::string& group) const;
+        std::vector<Entity> GetEntitiesByGroup(const std::string& group);
+        void RemoveEntityGroup(Entity entity);
+
+        // Dense id of a group name, the same in every registry and never reused,
+        // so hot paths can compare groups without comparing strings
+        static std::size_t GetGroupId(const std::string& group);
+        std::size_t GetEntityGroupId(Entity entity) const;
+
+        // Creates a new entity with a copy of every component and the group of
+        // entity. Owner thread only, the copies need the clone's signature slot
+        Entity CloneEntity(Entity entity);
+
         // Component management
         template <typename TComponent, typename ...Targs>
         void AddComponent(Entity entity, Targs&& ...args);
@@ -225,6 +518,11 @@ class Registry {
         template <typename TSystem, typename ...Targs>
         void AddSystem(Targs& ...args);
 
+        // Registers a system owned elsewhere (e.g. by a World) without
+        // taking ownership, it must stay alive until RemoveSystem<TSystem>()
+        template <typename TSystem>
+        void AttachSystem(TSystem& system);
+
         template <typename TSystem>
         void RemoveSystem();
 
@@ -242,12 +540,23 @@ class Registry {
 template <typename TSystem, typename ...Targs>
 void Registry::AddSystem(Targs& ...args) {
     std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<Targs>(args)...);
-    systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+    if(systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem)).second) {
+        IndexSystem(newSystem);
+    }
+}
+
+template <typename TSystem>
+void Registry::AttachSystem(TSystem& system) {
+    std::shared_ptr<TSystem> attachedSystem(&system, [](TSystem*) {});
+    if(systems.insert(std::make_pair(std::type_index(typeid(TSystem)), attachedSystem)).second) {
+        IndexSystem(attachedSystem);
+    }
 }
 
 template <typename TSystem>
 void Registry::RemoveSystem() {
     auto system = systems.find(std::type_index(typeid(TSystem)));
+    UnindexSystem(system->second);
     systems.erase(system);
 }
 
@@ -264,6 +573,17 @@ TSystem& Registry::GetSystem() const {
 
 template<typename TComponent, typename ...Targs>
 void Registry::AddComponent(Entity entity, Targs&& ...args) {
+    if(std::this_thread::get_id() != ownerThread) {
+        // The pools belong to the owner thread, keep a copy of the arguments for it
+        auto arguments = std::make_tuple(std::forward<Targs>(args)...);
+        GetThreadSpawnBuffer().componentAdds.push_back([this, entity, arguments]() mutable {
+            std::apply([this, entity](auto& ...values) {
+                AddComponent<TComponent>(entity, std::move(values)...);
+            }, arguments);
+        });
+        return;
+    }
+
     const auto componentId = Component<TComponent>::GetId();
     const auto entityId = entity.GetId();
 
@@ -287,7 +607,7 @@ void Registry::AddComponent(Entity entity, Targs&& ...args) {
     componentPool->Set(entityId, newComponent);
     entityComponentSignatures[entityId].set(componentId);
 
-    Logger::Log("Component id = " + std::to_string(componentId) + " was added to entity id " + std::to_string(entityId));
+    LOG_TRACE(LogCategory::ECS, "Component id = {} was added to entity id {}", componentId, entityId);
 }
 
 template <typename TComponent>
@@ -296,7 +616,7 @@ void Registry::RemoveComponent(Entity entity) {
     const auto entityId = entity.GetId();
     entityComponentSignatures[entityId].set(componentId, false);
 
-    Logger::Log("Component id = " + std::to_string(componentId) + " was removed from entity id " + std::to_string(entityId));
+    LOG_TRACE(LogCategory::ECS, "Component id = {} was removed from entity id {}", componentId, entityId);
 }
 
 template <typename TComponent>
@@ -0,0 +1,70 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <tuple>
+#include <type_traits>
+#include "ECS.h"
+
+///////////////////////////////////////////////////
+// World
+////////////////////////////////////////////////////
+// Compile-time alternative to Registry::AddSystem for a fixed set of systems.
+// The systems are stored by value in a tuple, so GetSystem<T>() resolves at
+// compile time instead of hashing a type_index and following a shared_ptr.
+// Entities and components still live in the registry the world is attached to.
+// Example: World<MovementSystem, RenderSystem> world{registry};
+////////////////////////////////////////////////////
+template <typename... TSystems>
+class World {
+    private:
+        Registry& registry;
+        std::tuple<TSystems...> systems;
+
+        template <typename TSystem, typename = void, typename... TArgs>
+        struct HasUpdate : std::false_type {};
+
+        template <typename TSystem, typename... TArgs>
+        struct HasUpdate<TSystem, std::void_t<decltype(std::declval<TSystem&>().Update(std::declval<TArgs&>()...))>, TArgs...> : std::true_type {};
+
+        template <typename TSystem, typename... TArgs>
+        void updateSystem(TArgs&... args) {
+            static_assert(HasUpdate<TSystem, void, TArgs...>::value, "World::Update names a system without an Update overload taking these arguments");
+            std::get<TSystem>(systems).Update(args...);
+        }
+
+    public:
+        explicit World(Registry& registry) : registry{registry} {
+            // The registry still decides which entities each system gets
+            (registry.AttachSystem(std::get<TSystems>(systems)), ...);
+        }
+
+        ~World() {
+            (registry.template RemoveSystem<TSystems>(), ...);
+        }
+
+        World(const World&) = delete;
+        World& operator =(const World&) = delete;
+
+        template <typename TSystem>
+        TSystem& GetSystem() {
+            return std::get<TSystem>(systems);
+        }
+
+        // Calls f on every system, in the order of the template arguments
+        template <typename F>
+        void ForEachSystem(F&& f) {
+            (f(std::get<TSystems>(systems)), ...);
+        }
+
+        // Calls Update(args...) on the named systems, in the order they are
+        // named. Each of them must have such an overload, the systems taking
+        // other arguments are updated by their own call
+        // Example: world.Update<MovementSystem, PhysicsSystem>(deltaTime);
+        template <typename... TUpdated, typename... TArgs>
+        void Update(TArgs&&... args) {
+            static_assert(sizeof...(TUpdated) > 0, "World::Update needs the systems to update");
+            (updateSystem<TUpdated>(args...), ...);
+        }
+};
+
+#endif
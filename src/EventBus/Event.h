@@ -1,10 +1,32 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <atomic>
+#include <cstddef>
+
 class Event
 {
 public:
     Event() = default;
 };
 
+// Hands out the dense ids the event bus uses to index its subscribers
+class IEventType
+{
+protected:
+    static inline std::atomic<std::size_t> nextId{0};
+};
+
+template <typename TEvent>
+class EventType : public IEventType
+{
+public:
+    // Returns the unique id of EventType<TEvent>
+    static std::size_t GetId()
+    {
+        static auto id = nextId++;
+        return id;
+    }
+};
+
 #endif // EVENT_H
@@ -1,53 +1,337 @@
 #ifndef EVENTBUS_H
 #define EVENTBUS_H
 
-#include <map>
-#include <typeindex>
+#include <vector>
+#include <string>
 #include <memory>
-#include <list>
-#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include "../ECS/ECS.h"
 #include "../Logger/Logger.h"
 #include "Event.h"
 
-class IEventCallback
+// Per event type and per subscriber statistics, compiled in when EVENTBUS_STATS is 1.
+// Debug builds collect them, release builds (NDEBUG) leave them out unless asked for
+#ifndef EVENTBUS_STATS
+#ifdef NDEBUG
+#define EVENTBUS_STATS 0
+#else
+#define EVENTBUS_STATS 1
+#endif
+#endif
+
+// A contiguous run of queued events handed to batch subscribers by EventBus::Dispatch
+template <typename TEvent>
+class EventSpan
 {
 public:
-    virtual ~IEventCallback() = default;
-    void Execute(Event &e)
+    EventSpan(TEvent *events, std::size_t count) : events{events}, count{count}
     {
-        Call(e);
     }
 
+    TEvent *begin() const { return events; }
+    TEvent *end() const { return events + count; }
+    TEvent &operator[](std::size_t index) const { return events[index]; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
 private:
-    virtual void Call(Event &e) = 0;
+    TEvent *events;
+    std::size_t count;
 };
 
+/*
+ * Splits a member callback into its owner and event types
+ * void (TOwner::*)(TEvent &) receives one event per call,
+ * void (TOwner::*)(EventSpan<TEvent>) receives every event of a dispatch at once
+ */
+template <typename TCallback>
+struct MemberCallbackTraits;
+
 template <typename TOwner, typename TEvent>
-using CallbackFunction = std::function<void(TOwner &, TEvent &)>;
+struct MemberCallbackTraits<void (TOwner::*)(TEvent &)>
+{
+    using Owner = TOwner;
+    using EventType = TEvent;
+    static constexpr bool isBatch = false;
+};
 
 template <typename TOwner, typename TEvent>
-class EventCallback : public IEventCallback
+struct MemberCallbackTraits<void (TOwner::*)(EventSpan<TEvent>)>
+{
+    using Owner = TOwner;
+    using EventType = TEvent;
+    static constexpr bool isBatch = true;
+};
+
+// Events routed to entity subscribers expose the entities they concern through GetTargets()
+template <typename TEvent, typename = void>
+struct HasEventTargets : std::false_type
+{
+};
+
+template <typename TEvent>
+struct HasEventTargets<TEvent, std::void_t<decltype(std::declval<const TEvent &>().GetTargets())>> : std::true_type
+{
+};
+
+#if EVENTBUS_STATS
+// Time spent in the callback of one subscription, a batch callback gets several events per call
+struct SubscriberStats
+{
+    std::uint64_t subscriptionId = 0;
+    std::size_t callCount = 0;
+    std::size_t eventCount = 0;
+    std::int64_t totalNs = 0;
+    std::int64_t maxNs = 0;
+};
+
+// Frame counts are taken between two calls to EventBus::EndFrame()
+struct EventTypeStats
+{
+    std::string name;
+    std::size_t emitsThisFrame = 0;
+    std::size_t emitsLastFrame = 0;
+    std::size_t maxEmitsPerFrame = 0;
+    std::size_t emitsTotal = 0;
+    std::size_t coalescedTotal = 0;
+    std::size_t subscriberCount = 0;
+    std::vector<SubscriberStats> subscribers;
+};
+#endif
+
+// Queued events exposing GetCoalescingKey() are delivered once per key and dispatch
+template <typename TEvent, typename = void>
+struct HasCoalescingKey : std::false_type
+{
+};
+
+template <typename TEvent>
+struct HasCoalescingKey<TEvent, std::void_t<decltype(std::declval<const TEvent &>().GetCoalescingKey())>> : std::true_type
+{
+};
+
+/*
+ * Drops the queued events whose key was already seen earlier in the queue
+ * The keys are sorted rather than hashed so the buffers are reused from frame to frame
+ */
+template <typename TEvent, bool = HasCoalescingKey<TEvent>::value>
+class EventCoalescer
 {
-    // Here we have the callback function pointer
-    // that needs to be invoked
 public:
-    // typedef void (TOwner::*CallbackFunction)(TEvent &);
-    EventCallback(TOwner &ownerInstance, std::function<void(TOwner &, TEvent &)> callbackFuncion) : ownerInstance{ownerInstance}, mCallbackFunction{callbackFuncion}
+    std::size_t Coalesce(std::vector<TEvent> &)
     {
+        return 0;
     }
+};
+
+template <typename TEvent>
+class EventCoalescer<TEvent, true>
+{
+public:
+    using Key = decltype(std::declval<const TEvent &>().GetCoalescingKey());
+
+    // Returns the number of events removed, the first event of every key keeps its place
+    std::size_t Coalesce(std::vector<TEvent> &events)
+    {
+        if (events.size() < 2)
+        {
+            return 0;
+        }
+
+        // Producers often queue in key order already, the sort is then skipped and
+        // the batch is left untouched when no two neighbours share their key
+        keys.clear();
+        bool isSorted = true;
+        bool hasDuplicates = false;
+        for (std::size_t i = 0; i < events.size(); i++)
+        {
+            keys.emplace_back(events[i].GetCoalescingKey(), i);
+            if (i > 0 && isSorted)
+            {
+                isSorted = !(keys[i].first < keys[i - 1].first);
+                hasDuplicates = hasDuplicates || keys[i].first == keys[i - 1].first;
+            }
+        }
+        if (isSorted && !hasDuplicates)
+        {
+            return 0;
+        }
+        if (!isSorted)
+        {
+            std::sort(keys.begin(), keys.end());
+        }
+
+        isKept.assign(events.size(), true);
+        for (std::size_t i = 1; i < keys.size(); i++)
+        {
+            if (keys[i].first == keys[i - 1].first)
+            {
+                isKept[keys[i].second] = false;
+            }
+        }
 
-    virtual ~EventCallback() override = default;
+        std::size_t keptCount = 0;
+        for (std::size_t i = 0; i < events.size(); i++)
+        {
+            if (isKept[i])
+            {
+                if (keptCount != i)
+                {
+                    events[keptCount] = std::move(events[i]);
+                }
+                keptCount++;
+            }
+        }
+
+        const auto removedCount = events.size() - keptCount;
+        events.erase(events.begin() + keptCount, events.end());
+        return removedCount;
+    }
 
 private:
-    TOwner &ownerInstance;
-    CallbackFunction<TOwner, TEvent> mCallbackFunction;
-    virtual void Call(Event &e) override
+    std::vector<std::pair<Key, std::size_t>> keys;
+    std::vector<char> isKept;
+};
+
+/*
+ * A subscribed callback, the owner instance plus a plain function pointer delivering
+ * a run of contiguous events of the subscribed type to the member callback
+ * Inactive ones are waiting to be removed once no event is being dispatched
+ */
+struct Subscriber
+{
+    std::uint64_t id = 0;
+    bool isActive = true;
+    void *ownerInstance = nullptr;
+    void (*invoke)(void *ownerInstance, void *events, std::size_t count) = nullptr;
+    // Entity subscriptions only: the entity the events must target, as its id may be reused
+    const Registry *targetRegistry = nullptr;
+    std::uint64_t targetGeneration = 0;
+#if EVENTBUS_STATS
+    SubscriberStats stats;
+#endif
+};
+
+using HandlerList = std::vector<Subscriber>;
+
+class IEventQueue
+{
+public:
+    virtual ~IEventQueue() = default;
+};
+
+// Staging buffer of one producer, padded so producers on different threads never share a cache line
+template <typename TEvent>
+struct alignas(64) EventLane
+{
+    std::vector<TEvent> events;
+};
+
+/*
+ * Events enqueued since the last dispatch, plus the ones being dispatched right now
+ * Events staged from other threads wait in their lanes until the next dispatch merges them
+ */
+template <typename TEvent>
+class EventQueue : public IEventQueue
+{
+public:
+    std::vector<TEvent> pending;
+    std::vector<TEvent> dispatching;
+    std::vector<EventLane<TEvent>> lanes;
+    EventCoalescer<TEvent> coalescer;
+    bool isDispatching = false;
+};
+
+class EventBus;
+
+/*
+ * Where a subscription is stored: with the subscribers of every event of its type,
+ * of the events targeting one entity (index = entity id) or one group (index = group id)
+ */
+struct SubscriptionRoute
+{
+    enum Kind
+    {
+        ALL,
+        ENTITY,
+        GROUP
+    };
+
+    Kind kind = ALL;
+    std::size_t index = 0;
+};
+
+/*
+ * Keeps a subscription alive until it is unsubscribed or the handle is destroyed
+ * The handle must not outlive the event bus it was returned by
+ * Example: collisionSubscription = eventBus.SubscribeToEvent<&DamageSystem::onCollision>(*this);
+ */
+class SubscriptionHandle
+{
+public:
+    SubscriptionHandle() = default;
+
+    SubscriptionHandle(EventBus &eventBus, std::size_t eventTypeId, SubscriptionRoute route, std::uint64_t id) : eventBus{&eventBus}, eventTypeId{eventTypeId}, route{route}, id{id}
+    {
+    }
+
+    SubscriptionHandle(const SubscriptionHandle &) = delete;
+    SubscriptionHandle &operator=(const SubscriptionHandle &) = delete;
+
+    SubscriptionHandle(SubscriptionHandle &&other) noexcept : eventBus{other.eventBus}, eventTypeId{other.eventTypeId}, route{other.route}, id{other.id}
     {
-        std::invoke(mCallbackFunction, ownerInstance, static_cast<TEvent &>(e));
+        other.eventBus = nullptr;
     }
+
+    SubscriptionHandle &operator=(SubscriptionHandle &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Unsubscribe();
+            eventBus = other.eventBus;
+            eventTypeId = other.eventTypeId;
+            route = other.route;
+            id = other.id;
+            other.eventBus = nullptr;
+        }
+        return *this;
+    }
+
+    ~SubscriptionHandle()
+    {
+        Unsubscribe();
+    }
+
+    // Removes the callback from the event bus, safe to call while its event is being dispatched
+    void Unsubscribe();
+
+    bool IsSubscribed() const
+    {
+        return eventBus != nullptr;
+    }
+
+private:
+    EventBus *eventBus = nullptr;
+    std::size_t eventTypeId = 0;
+    SubscriptionRoute route;
+    std::uint64_t id = 0;
 };
 
-using HandlerList = std::list<std::unique_ptr<IEventCallback>>;
+// Subscribers of one event type that only want the events targeting an entity or a group
+struct TargetedHandlers
+{
+    // Indexed by entity id
+    std::vector<HandlerList> byEntity;
+    // Indexed by Registry::GetGroupId(), group ids are never reused so the routes of the handles stay valid
+    std::vector<HandlerList> byGroup;
+    // Active subscribers across both, the lists themselves are kept once emptied
+    std::size_t activeCount = 0;
+};
 
 class EventBus
 {
@@ -65,45 +349,686 @@ public:
     // Clears the subscribers list
     void Reset()
     {
-        subscribers.clear();
+        if (dispatchDepth == 0)
+        {
+            subscribers.clear();
+            targetedSubscribers.clear();
+            return;
+        }
+
+        // Callbacks might be running, they are removed once the dispatch is over
+        forEachHandlerList([](HandlerList &handlers)
+        {
+            for (auto &subscriber : handlers)
+            {
+                subscriber.isActive = false;
+            }
+        });
+        for (auto &targeted : targetedSubscribers)
+        {
+            targeted.activeCount = 0;
+        }
+        hasInactiveSubscribers = true;
+    }
+
+    /*
+     * Subscribe a member callback to the event type it takes
+     * A listener subscribes to an event once and stays subscribed until the returned handle
+     * is unsubscribed or destroyed, callbacks taking an EventSpan<TEvent> get the events in batches
+     * Example: auto handle = eventBus.SubscribeToEvent<&Game::onCollision>(*this)
+     */
+    template <auto Callback>
+    [[nodiscard]] SubscriptionHandle SubscribeToEvent(typename MemberCallbackTraits<decltype(Callback)>::Owner &ownerInstance)
+    {
+        using TEvent = typename MemberCallbackTraits<decltype(Callback)>::EventType;
+
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= subscribers.size())
+        {
+            subscribers.resize(eventTypeId + 1);
+        }
+
+        const auto id = addSubscriber<Callback>(subscribers[eventTypeId], ownerInstance);
+        return SubscriptionHandle{*this, eventTypeId, SubscriptionRoute{}, id};
+    }
+
+    /*
+     * Subscribe a member callback to the events of its type targeting one entity
+     * The event type lists the entities it concerns in GetTargets()
+     * Once the entity is killed its id may name another one, which the subscription ignores
+     * Example: auto handle = eventBus.SubscribeToEvent<&Player::onHit>(*this, playerEntity)
+     */
+    template <auto Callback>
+    [[nodiscard]] SubscriptionHandle SubscribeToEvent(typename MemberCallbackTraits<decltype(Callback)>::Owner &ownerInstance, Entity target)
+    {
+        using TEvent = typename MemberCallbackTraits<decltype(Callback)>::EventType;
+        static_assert(HasEventTargets<TEvent>::value, "Entity subscriptions need an event exposing GetTargets()");
+
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        auto &targeted = getTargetedHandlers(eventTypeId);
+        auto &byEntity = targeted.byEntity;
+        if (target.GetId() >= byEntity.size())
+        {
+            byEntity.resize(target.GetId() + 1);
+        }
+
+        targeted.activeCount++;
+        auto &handlers = byEntity[target.GetId()];
+        const auto id = addSubscriber<Callback>(handlers, ownerInstance);
+        handlers.back().targetRegistry = target.registry;
+        handlers.back().targetGeneration = generationOf(target);
+        return SubscriptionHandle{*this, eventTypeId, SubscriptionRoute{SubscriptionRoute::ENTITY, target.GetId()}, id};
     }
 
     /*
-     * Subscribe to an event type <T>
-     * A listener subscribes to an event
-     * Example: eventBus.SubscribeToEvent<CollisionEvent>(this, &Game::onCollision)
+     * Subscribe a member callback to the events of its type targeting at least one entity of a group
+     * The callback is called once per event, however many of its targets belong to the group
+     * Example: auto handle = eventBus.SubscribeToEvent<&Game::onEnemyHit>(*this, "enemies")
      */
-    template <typename TOwner, typename TEvent>
-    void SubscribeToEvent(TOwner &ownerInstance, void (TOwner::*callbackFunction)(TEvent &))
+    template <auto Callback>
+    [[nodiscard]] SubscriptionHandle SubscribeToEvent(typename MemberCallbackTraits<decltype(Callback)>::Owner &ownerInstance, const std::string &group)
+    {
+        using TEvent = typename MemberCallbackTraits<decltype(Callback)>::EventType;
+        static_assert(HasEventTargets<TEvent>::value, "Group subscriptions need an event exposing GetTargets()");
+
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        const auto groupId = Registry::GetGroupId(group);
+        auto &targeted = getTargetedHandlers(eventTypeId);
+        auto &byGroup = targeted.byGroup;
+        if (groupId >= byGroup.size())
+        {
+            byGroup.resize(groupId + 1);
+        }
+
+        targeted.activeCount++;
+        const auto id = addSubscriber<Callback>(byGroup[groupId], ownerInstance);
+        return SubscriptionHandle{*this, eventTypeId, SubscriptionRoute{SubscriptionRoute::GROUP, groupId}, id};
+    }
+
+    void Unsubscribe(std::size_t eventTypeId, SubscriptionRoute route, std::uint64_t id)
     {
-        if (subscribers.find(typeid(TEvent)) == subscribers.end())
+        auto *handlers = findHandlers(eventTypeId, route);
+        if (!handlers)
+        {
+            return;
+        }
+
+        auto subscriber = std::find_if(handlers->begin(), handlers->end(), [id](const Subscriber &s) { return s.id == id; });
+        if (subscriber == handlers->end())
         {
-            subscribers[typeid(TEvent)] = HandlerList{};
+            return;
         }
 
-        auto subscriber = std::make_unique<EventCallback<TOwner, TEvent>>(ownerInstance, callbackFunction);
-        subscribers[typeid(TEvent)].push_back(std::move(subscriber));
+        if (route.kind != SubscriptionRoute::ALL && subscriber->isActive)
+        {
+            targetedSubscribers[eventTypeId].activeCount--;
+        }
+
+        if (dispatchDepth == 0)
+        {
+            handlers->erase(subscriber);
+        }
+        else
+        {
+            subscriber->isActive = false;
+            hasInactiveSubscribers = true;
+        }
     }
 
     /*
      * Emit an event of type <T>
-     * As soon as something emits an event
-     * we go ahed and execute all the listener callback functions
-     * Example: eventBus.EmitEvent<CollisionEvent>(player, entity);
+     * The event is constructed once and delivered right away to every listener callback
+     * Example: eventBus.EmitEvent<KeyPressedEvent>(keycode);
      */
     template <typename TEvent, typename... TArgs>
     void EmitEvent(TArgs &&...args)
     {
-        auto &handlers = subscribers[typeid(TEvent)];
-        for (const auto &h : handlers)
+        const auto eventTypeId = EventType<TEvent>::GetId();
+#if EVENTBUS_STATS
+        // Counted even without listeners, the emits nobody hears are worth knowing about
+        recordEmits<TEvent>(1);
+#endif
+        if (!hasListeners(eventTypeId))
         {
-            TEvent event{std::forward<TArgs>(args)...};
-            h->Execute(event);
+            return;
         }
+
+        TEvent event{std::forward<TArgs>(args)...};
+        deliver(&event, 1);
+    }
+
+    /*
+     * Queue an event of type <T> until Dispatch<T>() is called
+     * Events of the same type are stored next to each other and reuse their buffer every frame
+     * Example: eventBus.Enqueue<CollisionEvent>(entityA, entityB);
+     */
+    template <typename TEvent, typename... TArgs>
+    void Enqueue(TArgs &&...args)
+    {
+        getQueue<TEvent>().pending.emplace_back(std::forward<TArgs>(args)...);
+    }
+
+    /*
+     * Prepare <laneCount> staging lanes for events of type <T>
+     * Must be called from the thread owning the event bus before the producers start
+     * Example: eventBus.ReserveLanes<CollisionEvent>(jobCount);
+     */
+    template <typename TEvent>
+    void ReserveLanes(std::size_t laneCount)
+    {
+        auto &queue = getQueue<TEvent>();
+        if (queue.lanes.size() < laneCount)
+        {
+            queue.lanes.resize(laneCount);
+        }
+    }
+
+    /*
+     * Queue an event of type <T> from a producer thread, without locking
+     * Each lane must only be used by one thread at a time, typically lane = job index,
+     * so the merged order only depends on how the work was split and not on thread timing
+     * Example: eventBus.EnqueueToLane<CollisionEvent>(jobIndex, entityA, entityB);
+     */
+    template <typename TEvent, typename... TArgs>
+    void EnqueueToLane(std::size_t lane, TArgs &&...args)
+    {
+        auto &queue = static_cast<EventQueue<TEvent> &>(*queues[EventType<TEvent>::GetId()]);
+        queue.lanes[lane].events.emplace_back(std::forward<TArgs>(args)...);
+    }
+
+    /*
+     * Deliver every queued event of type <T>
+     * This is the sync point for the lanes: once the producers are done, the staged events
+     * are appended after the ones enqueued directly, lane by lane in lane order
+     * Events exposing GetCoalescingKey() are then delivered once per key, in the place of the first one
+     * Batch callbacks get all of them in one call, the others get one call per event
+     * Events enqueued while dispatching wait for the next Dispatch<T>(), the ones of a type
+     * nobody subscribed to are dropped
+     */
+    template <typename TEvent>
+    void Dispatch()
+    {
+        auto &queue = getQueue<TEvent>();
+        if (queue.isDispatching)
+        {
+            return;
+        }
+
+        // Nobody to deliver to, drop the events before paying for their coalescing
+        if (!hasListeners(EventType<TEvent>::GetId()))
+        {
+#if EVENTBUS_STATS
+            recordEmits<TEvent>(GetQueuedCount<TEvent>());
+#endif
+            queue.pending.clear();
+            for (auto &lane : queue.lanes)
+            {
+                lane.events.clear();
+            }
+            return;
+        }
+
+        mergeLanes(queue);
+        const auto coalescedCount = queue.coalescer.Coalesce(queue.pending);
+#if EVENTBUS_STATS
+        recordEventType<TEvent>().coalescedTotal += coalescedCount;
+#else
+        (void)coalescedCount;
+#endif
+        if (queue.pending.empty())
+        {
+            return;
+        }
+#if EVENTBUS_STATS
+        recordEmits<TEvent>(queue.pending.size());
+#endif
+
+        queue.dispatching.swap(queue.pending);
+        queue.isDispatching = true;
+        deliver(queue.dispatching.data(), queue.dispatching.size());
+        queue.isDispatching = false;
+        queue.dispatching.clear();
+    }
+
+    // Whether an event of type <T> would reach a subscriber, targeted ones included,
+    // so producers can skip building events nobody listens to
+    template <typename TEvent>
+    bool HasSubscribers() const
+    {
+        return hasListeners(EventType<TEvent>::GetId());
+    }
+
+    template <typename TEvent>
+    size_t GetQueuedCount()
+    {
+        const auto &queue = getQueue<TEvent>();
+        auto count = queue.pending.size();
+        for (const auto &lane : queue.lanes)
+        {
+            count += lane.events.size();
+        }
+        return count;
+    }
+
+    /*
+     * Marks the end of a frame for the statistics, dumping them every few frames
+     * Compiles to nothing when EVENTBUS_STATS is 0
+     */
+    void EndFrame()
+    {
+#if EVENTBUS_STATS
+        for (auto &typeStats : eventTypeStats)
+        {
+            typeStats.emitsLastFrame = typeStats.emitsThisFrame;
+            typeStats.maxEmitsPerFrame = std::max(typeStats.maxEmitsPerFrame, typeStats.emitsThisFrame);
+            typeStats.emitsThisFrame = 0;
+        }
+
+        frameCount++;
+        if (statsDumpInterval > 0 && frameCount % statsDumpInterval == 0)
+        {
+            DumpStats();
+        }
+#endif
+    }
+
+#if EVENTBUS_STATS
+    // Number of frames between two dumps of the statistics to the log, 0 turns the dumps off
+    void SetStatsDumpInterval(std::size_t frames)
+    {
+        statsDumpInterval = frames;
+    }
+
+    // Snapshot of the statistics of every event type emitted or subscribed to so far
+    std::vector<EventTypeStats> GetStats()
+    {
+        std::vector<EventTypeStats> stats = eventTypeStats;
+        const auto addSubscribers = [&stats](std::size_t eventTypeId, const HandlerList &handlers)
+        {
+            if (eventTypeId >= stats.size())
+            {
+                stats.resize(eventTypeId + 1);
+            }
+            for (const auto &subscriber : handlers)
+            {
+                if (subscriber.isActive)
+                {
+                    stats[eventTypeId].subscriberCount++;
+                    stats[eventTypeId].subscribers.push_back(subscriber.stats);
+                }
+            }
+        };
+
+        for (std::size_t eventTypeId = 0; eventTypeId < subscribers.size(); eventTypeId++)
+        {
+            addSubscribers(eventTypeId, subscribers[eventTypeId]);
+        }
+        for (std::size_t eventTypeId = 0; eventTypeId < targetedSubscribers.size(); eventTypeId++)
+        {
+            for (const auto &handlers : targetedSubscribers[eventTypeId].byEntity)
+            {
+                addSubscribers(eventTypeId, handlers);
+            }
+            for (const auto &handlers : targetedSubscribers[eventTypeId].byGroup)
+            {
+                addSubscribers(eventTypeId, handlers);
+            }
+        }
+        return stats;
+    }
+
+    void DumpStats()
+    {
+        for (const auto &typeStats : GetStats())
+        {
+            if (typeStats.name.empty())
+            {
+                continue;
+            }
+
+            LOG_INFO(LogCategory::EVENTS, "{}: {} emits last frame, {} max per frame, {} total, {} coalesced, {} subscribers",
+                     typeStats.name, typeStats.emitsLastFrame, typeStats.maxEmitsPerFrame, typeStats.emitsTotal, typeStats.coalescedTotal, typeStats.subscriberCount);
+            for (const auto &subscriberStats : typeStats.subscribers)
+            {
+                LOG_INFO(LogCategory::EVENTS, "    subscription {}: {} calls for {} events, {} us total, {} us max",
+                         subscriberStats.subscriptionId, subscriberStats.callCount, subscriberStats.eventCount, subscriberStats.totalNs / 1000, subscriberStats.maxNs / 1000);
+            }
+        }
+    }
+#endif
+
+    size_t GetSubscriberCount()
+    {
+        size_t count = 0;
+        forEachHandlerList([&count](HandlerList &handlers)
+        {
+            count += std::count_if(handlers.begin(), handlers.end(), [](const Subscriber &s) { return s.isActive; });
+        });
+        return count;
     }
 
 private:
-    std::map<std::type_index, HandlerList> subscribers;
+    // Indexed by EventType<TEvent>::GetId()
+    std::vector<HandlerList> subscribers;
+    // Also indexed by EventType<TEvent>::GetId(), created on the first entity or group subscription of a type
+    std::vector<TargetedHandlers> targetedSubscribers;
+    // Also indexed by EventType<TEvent>::GetId(), created on the first Enqueue of a type
+    std::vector<std::unique_ptr<IEventQueue>> queues;
+    std::uint64_t nextSubscriptionId = 1;
+    int dispatchDepth = 0;
+    bool hasInactiveSubscribers = false;
+
+#if EVENTBUS_STATS
+    // Indexed by EventType<TEvent>::GetId(), the subscriber stats live in the subscribers
+    std::vector<EventTypeStats> eventTypeStats;
+    std::size_t frameCount = 0;
+    std::size_t statsDumpInterval = 600;
+#endif
+
+    template <auto Callback>
+    std::uint64_t addSubscriber(HandlerList &handlers, typename MemberCallbackTraits<decltype(Callback)>::Owner &ownerInstance)
+    {
+        using Traits = MemberCallbackTraits<decltype(Callback)>;
+        using TOwner = typename Traits::Owner;
+        using TEvent = typename Traits::EventType;
+
+        auto invoke = [](void *instance, void *events, std::size_t count)
+        {
+            auto *owner = static_cast<TOwner *>(instance);
+            auto *typedEvents = static_cast<TEvent *>(events);
+            if constexpr (Traits::isBatch)
+            {
+                (owner->*Callback)(EventSpan<TEvent>{typedEvents, count});
+            }
+            else
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    (owner->*Callback)(typedEvents[i]);
+                }
+            }
+        };
+
+        Subscriber subscriber;
+        subscriber.id = nextSubscriptionId++;
+        subscriber.ownerInstance = &ownerInstance;
+        subscriber.invoke = invoke;
+#if EVENTBUS_STATS
+        subscriber.stats.subscriptionId = subscriber.id;
+        recordEventType<TEvent>();
+#endif
+        handlers.push_back(subscriber);
+        return subscriber.id;
+    }
+
+#if EVENTBUS_STATS
+    template <typename TEvent>
+    EventTypeStats &recordEventType()
+    {
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= eventTypeStats.size())
+        {
+            eventTypeStats.resize(eventTypeId + 1);
+        }
+        if (eventTypeStats[eventTypeId].name.empty())
+        {
+            eventTypeStats[eventTypeId].name = DemangleTypeName(typeid(TEvent).name());
+        }
+        return eventTypeStats[eventTypeId];
+    }
+
+    template <typename TEvent>
+    void recordEmits(std::size_t count)
+    {
+        auto &typeStats = recordEventType<TEvent>();
+        typeStats.emitsThisFrame += count;
+        typeStats.emitsTotal += count;
+    }
+#endif
+
+    TargetedHandlers &getTargetedHandlers(std::size_t eventTypeId)
+    {
+        if (eventTypeId >= targetedSubscribers.size())
+        {
+            targetedSubscribers.resize(eventTypeId + 1);
+        }
+        return targetedSubscribers[eventTypeId];
+    }
+
+    HandlerList *findHandlers(std::size_t eventTypeId, SubscriptionRoute route)
+    {
+        switch (route.kind)
+        {
+        case SubscriptionRoute::ALL:
+            return eventTypeId < subscribers.size() ? &subscribers[eventTypeId] : nullptr;
+        case SubscriptionRoute::ENTITY:
+            if (eventTypeId < targetedSubscribers.size() && route.index < targetedSubscribers[eventTypeId].byEntity.size())
+            {
+                return &targetedSubscribers[eventTypeId].byEntity[route.index];
+            }
+            return nullptr;
+        case SubscriptionRoute::GROUP:
+            if (eventTypeId < targetedSubscribers.size() && route.index < targetedSubscribers[eventTypeId].byGroup.size())
+            {
+                return &targetedSubscribers[eventTypeId].byGroup[route.index];
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    template <typename TFunc>
+    void forEachHandlerList(TFunc func)
+    {
+        for (auto &handlers : subscribers)
+        {
+            func(handlers);
+        }
+        for (auto &targeted : targetedSubscribers)
+        {
+            for (auto &handlers : targeted.byEntity)
+            {
+                func(handlers);
+            }
+            for (auto &handlers : targeted.byGroup)
+            {
+                func(handlers);
+            }
+        }
+    }
+
+    bool hasSubscribers(std::size_t eventTypeId) const
+    {
+        return eventTypeId < subscribers.size() && !subscribers[eventTypeId].empty();
+    }
+
+    // Whether an event of the type would reach anyone, targeted routes included
+    bool hasListeners(std::size_t eventTypeId) const
+    {
+        return hasSubscribers(eventTypeId) ||
+               (eventTypeId < targetedSubscribers.size() && targetedSubscribers[eventTypeId].activeCount > 0);
+    }
+
+    static std::uint64_t generationOf(const Entity &entity)
+    {
+        return entity.registry ? entity.GetGeneration() : 0;
+    }
+
+    static std::size_t groupIdOf(const Entity &entity)
+    {
+        return entity.registry ? entity.GetGroupId() : NO_GROUP_ID;
+    }
+
+    template <typename TEvent>
+    EventQueue<TEvent> &getQueue()
+    {
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        if (eventTypeId >= queues.size())
+        {
+            queues.resize(eventTypeId + 1);
+        }
+        if (!queues[eventTypeId])
+        {
+            queues[eventTypeId] = std::make_unique<EventQueue<TEvent>>();
+        }
+        return static_cast<EventQueue<TEvent> &>(*queues[eventTypeId]);
+    }
+
+    template <typename TEvent>
+    void mergeLanes(EventQueue<TEvent> &queue)
+    {
+        for (auto &lane : queue.lanes)
+        {
+            queue.pending.insert(queue.pending.end(), std::make_move_iterator(lane.events.begin()), std::make_move_iterator(lane.events.end()));
+            lane.events.clear();
+        }
+    }
+
+    /*
+     * Calls the subscribers of the list returned by getHandlers(), which is looked up again
+     * for every subscriber as a subscription made by a callback may reallocate the lists
+     * Callbacks subscribed while dispatching only receive the next events
+     */
+    template <typename TGetHandlers>
+    void invokeHandlers(TGetHandlers getHandlers, void *events, std::size_t count)
+    {
+        invokeHandlers(getHandlers, events, count, [](const Subscriber &) { return true; });
+    }
+
+    // Same, skipping the subscribers accepts(subscriber) turns down
+    template <typename TGetHandlers, typename TAccepts>
+    void invokeHandlers(TGetHandlers getHandlers, void *events, std::size_t count, TAccepts accepts)
+    {
+        const auto handlerCount = getHandlers().size();
+        for (size_t i = 0; i < handlerCount; i++)
+        {
+            const auto subscriber = getHandlers()[i];
+            if (subscriber.isActive && accepts(subscriber))
+            {
+#if EVENTBUS_STATS
+                const auto start = LogClock::Now();
+                subscriber.invoke(subscriber.ownerInstance, events, count);
+                const auto elapsed = LogClock::Now() - start;
+
+                // Removals during a dispatch are deferred, so the subscriber is still at index i
+                auto &stats = getHandlers()[i].stats;
+                stats.callCount++;
+                stats.eventCount += count;
+                stats.totalNs += elapsed;
+                stats.maxNs = std::max(stats.maxNs, elapsed);
+#else
+                subscriber.invoke(subscriber.ownerInstance, events, count);
+#endif
+            }
+        }
+    }
+
+    template <typename TEvent>
+    void deliver(TEvent *events, std::size_t count)
+    {
+        const auto eventTypeId = EventType<TEvent>::GetId();
+        dispatchDepth++;
+
+        if (hasSubscribers(eventTypeId))
+        {
+            invokeHandlers([this, eventTypeId]() -> HandlerList & { return subscribers[eventTypeId]; }, events, count);
+        }
+
+        if constexpr (HasEventTargets<TEvent>::value)
+        {
+            if (eventTypeId < targetedSubscribers.size() && targetedSubscribers[eventTypeId].activeCount > 0)
+            {
+                deliverToTargets(eventTypeId, events, count);
+            }
+        }
+
+        dispatchDepth--;
+        if (dispatchDepth == 0 && hasInactiveSubscribers)
+        {
+            removeInactiveSubscribers();
+        }
+    }
+
+    /*
+     * Routes every event to the subscribers of its targets, then of the groups its targets belong to
+     * An entity subscriber only gets the events of the entity it subscribed to: one holding its id
+     * in another registry is skipped, and once the id was reused the subscriber is dropped
+     */
+    template <typename TEvent>
+    void deliverToTargets(std::size_t eventTypeId, TEvent *events, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto &event = events[i];
+            const auto targets = event.GetTargets();
+            for (const Entity &target : targets)
+            {
+                const auto entityId = target.GetId();
+                if (entityId < targetedSubscribers[eventTypeId].byEntity.size())
+                {
+                    const auto generation = generationOf(target);
+                    retireStaleSubscribers(targetedSubscribers[eventTypeId], entityId, target.registry, generation);
+                    invokeHandlers([this, eventTypeId, entityId]() -> HandlerList & { return targetedSubscribers[eventTypeId].byEntity[entityId]; }, &event, 1,
+                                   [&target, generation](const Subscriber &subscriber)
+                    {
+                        return subscriber.targetRegistry == target.registry && subscriber.targetGeneration == generation;
+                    });
+                }
+            }
+
+            const auto groupCount = targetedSubscribers[eventTypeId].byGroup.size();
+            if (groupCount == 0)
+            {
+                continue;
+            }
+            for (auto target = targets.begin(); target != targets.end(); ++target)
+            {
+                const auto groupId = groupIdOf(*target);
+                if (groupId >= groupCount || targetedSubscribers[eventTypeId].byGroup[groupId].empty())
+                {
+                    continue;
+                }
+                // Once per event however many of its targets share the group
+                const auto isDelivered = std::any_of(targets.begin(), target, [groupId](const Entity &other) { return groupIdOf(other) == groupId; });
+                if (!isDelivered)
+                {
+                    invokeHandlers([this, eventTypeId, groupId]() -> HandlerList & { return targetedSubscribers[eventTypeId].byGroup[groupId]; }, &event, 1);
+                }
+            }
+        }
+    }
+
+    // Marks for removal the subscribers of an entity of registry whose id now holds another entity
+    void retireStaleSubscribers(TargetedHandlers &targeted, std::size_t entityId, const Registry *registry, std::uint64_t generation)
+    {
+        for (auto &subscriber : targeted.byEntity[entityId])
+        {
+            if (subscriber.isActive && subscriber.targetRegistry == registry && subscriber.targetGeneration != generation)
+            {
+                subscriber.isActive = false;
+                targeted.activeCount--;
+                hasInactiveSubscribers = true;
+            }
+        }
+    }
+
+    void removeInactiveSubscribers()
+    {
+        forEachHandlerList([](HandlerList &handlers)
+        {
+            handlers.erase(std::remove_if(handlers.begin(), handlers.end(), [](const Subscriber &s) { return !s.isActive; }), handlers.end());
+        });
+        hasInactiveSubscribers = false;
+    }
 };
 
-#endif // EVENTBUS_H
\ No newline at end of file
+inline void SubscriptionHandle::Unsubscribe()
+{
+    if (eventBus)
+    {
+        eventBus->Unsubscribe(eventTypeId, route, id);
+        eventBus = nullptr;
+    }
+}
+
+#endif // EVENTBUS_H
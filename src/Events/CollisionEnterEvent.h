@@ -0,0 +1,13 @@
+#ifndef COLLISIONENTEREVENT_H
+#define COLLISIONENTEREVENT_H
+
+#include "CollisionEvent.h"
+
+// Sent by the CollisionSystem on the first frame two colliders overlap
+class CollisionEnterEvent : public CollisionEvent
+{
+public:
+    using CollisionEvent::CollisionEvent;
+};
+
+#endif // COLLISIONENTEREVENT_H
@@ -1,6 +1,9 @@
 #ifndef COLLISIONEVENT_H
 #define COLLISIONEVENT_H
 
+#include <array>
+#include <utility>
+#include <algorithm>
 #include "../ECS/ECS.h"
 #include "../EventBus/Event.h"
 
@@ -12,6 +15,18 @@ public:
     CollisionEvent(Entity a, Entity b) : a{a}, b{b}
     {
     }
+
+    // Lets the event bus route the event to the subscribers of either entity
+    std::array<Entity, 2> GetTargets() const
+    {
+        return {a, b};
+    }
+
+    // The same two entities colliding is reported once per dispatch, whichever comes first
+    std::pair<std::size_t, std::size_t> GetCoalescingKey() const
+    {
+        return {std::min(a.GetId(), b.GetId()), std::max(a.GetId(), b.GetId())};
+    }
 };
 
 #endif // COLLISIONEVENT_H
\ No newline at end of file
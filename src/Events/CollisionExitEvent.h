@@ -0,0 +1,14 @@
+#ifndef COLLISIONEXITEVENT_H
+#define COLLISIONEXITEVENT_H
+
+#include "CollisionEvent.h"
+
+// Sent by the CollisionSystem on the first frame two colliders stop overlapping,
+// either entity may have been killed since
+class CollisionExitEvent : public CollisionEvent
+{
+public:
+    using CollisionEvent::CollisionEvent;
+};
+
+#endif // COLLISIONEXITEVENT_H
@@ -0,0 +1,13 @@
+#ifndef COLLISIONSTAYEVENT_H
+#define COLLISIONSTAYEVENT_H
+
+#include "CollisionEvent.h"
+
+// Sent by the CollisionSystem on every following frame the two colliders still overlap
+class CollisionStayEvent : public CollisionEvent
+{
+public:
+    using CollisionEvent::CollisionEvent;
+};
+
+#endif // COLLISIONSTAYEVENT_H
@@ -7,13 +7,6 @@
 #include "../Components/SpriteComponent.h"
 #include "../Components/AnimationComponent.h"
 #include "../Components/BoxColliderComponent.h"
-#include "../Systems/MovementSystem.h"
-#include "../Systems/RenderSystem.h"
-#include "../Systems/AnimationSystem.h"
-#include "../Systems/CollisionSystem.h"
-#include "../Systems/RenderColliderSystem.h"
-#include "../Systems/DamageSystem.h"
-#include "../Systems/KeyBoardmovementSystem.h"
 
 Game::Game()
 {
@@ -101,15 +94,6 @@ void Game::ProcessInput()
 
 void Game::LoadLevel(int level)
 {
-    // Add the systems that need to be processed in our game
-    registry.AddSystem<MovementSystem>();
-    registry.AddSystem<RenderSystem>();
-    registry.AddSystem<AnimationSystem>();
-    registry.AddSystem<CollisionSystem>();
-    registry.AddSystem<RenderColliderSystem>();
-    registry.AddSystem<DamageSystem>();
-    registry.AddSystem<KeyBoardMovementSystem>();
-
     // Add assets to the asset store
     const std::string tankSpriteId = "tank-image";
     assetStore.AddTexture(renderer, tankSpriteId, "./assets/images/tank-panther-right.png");
@@ -120,48 +104,64 @@ void Game::LoadLevel(int level)
     assetStore.AddTexture(renderer, "chopper-image", "./assets/images/chopper.png");
     assetStore.AddTexture(renderer, "radar-image", "./assets/images/radar.png");
 
-    constexpr int tileSize = 32;
-    constexpr double tileScale = 2.5;
-    TileMapLoader tilemapLoader("./assets/tilemaps/jungle.map", "./assets/tilemaps/jungle.png", tileSize);
-
-    auto map = tilemapLoader.getMap();
-    for (const auto &tile : map)
+    // Spawn the level entities into a separate registry on a worker thread,
+    // Update() swaps it in as the live world once it is ready
+    pendingLevel = std::async(std::launch::async, [this, tankSpriteId, tileMapSpriteId, tileMapPng]()
     {
-        auto tileBackground = registry.CreateEntity();
-        tileBackground.AddComponent<TransformComponent>(
-            glm::vec2(tileScale * tileSize * tile.relativePosition.x, tileScale * tileSize * tile.relativePosition.y),
-            glm::vec2(tileScale, tileScale));
-        tileBackground.AddComponent<SpriteComponent>(tileMapSpriteId, tileSize, tileSize, 0, tile.pixelSrcPosition.x, tile.pixelSrcPosition.y);
-    }
+        auto levelRegistry = std::make_unique<Registry>();
+
+        constexpr int tileSize = 32;
+        constexpr double tileScale = 2.5;
+        TileMapLoader tilemapLoader("./assets/tilemaps/jungle.map", tileMapPng, tileSize);
+
+        auto map = tilemapLoader.getMap();
+        for (const auto &tile : map)
+        {
+            auto tileBackground = levelRegistry->CreateEntity();
+            tileBackground.AddComponent<TransformComponent>(
+                glm::vec2(tileScale * tileSize * tile.relativePosition.x, tileScale * tileSize * tile.relativePosition.y),
+                glm::vec2(tileScale, tileScale));
+            tileBackground.AddComponent<SpriteComponent>(tileMapSpriteId, tileSize, tileSize, 0, tile.pixelSrcPosition.x, tile.pixelSrcPosition.y);
+            tileBackground.Group("tiles");
+        }
 
-    Entity chopper = registry.CreateEntity();
-    chopper.AddComponent<TransformComponent>(glm::vec2(10.0, 100.0), glm::vec2(1.5, 1.5), 0.0);
-    chopper.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
-    chopper.AddComponent<SpriteComponent>("chopper-image", tileSize, tileSize, 3);
-    chopper.AddComponent<AnimationComponent>(2, 15, true);
-
-    Entity radar = registry.CreateEntity();
-    radar.AddComponent<TransformComponent>(glm::vec2(windowWidth - 100, 10.0), glm::vec2(1.5, 1.5), 0.0);
-    radar.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
-    radar.AddComponent<SpriteComponent>("radar-image", 64, 64, 2);
-    radar.AddComponent<AnimationComponent>(8, 5, true);
-
-    Entity tank = registry.CreateEntity();
-    tank.AddComponent<TransformComponent>(glm::vec2(500.0, 10.0), glm::vec2(1.5, 1.5), 0.0);
-    tank.AddComponent<RigidBodyComponent>(glm::vec2(-30.0, 0.0));
-    tank.AddComponent<SpriteComponent>(tankSpriteId, tileSize, tileSize, 2);
-    tank.AddComponent<BoxColliderComponent>(32, 32);
-
-    Entity truck = registry.CreateEntity();
-    truck.AddComponent<TransformComponent>(glm::vec2(10.0, 10.0), glm::vec2(1.5, 1.5), 0.0);
-    truck.AddComponent<RigidBodyComponent>(glm::vec2(20.0, 0.0));
-    truck.AddComponent<SpriteComponent>("truck-image", tileSize, tileSize, 1);
-    truck.AddComponent<BoxColliderComponent>(32, 32);
+        Entity chopper = levelRegistry->CreateEntity();
+        chopper.AddComponent<TransformComponent>(glm::vec2(10.0, 100.0), glm::vec2(1.5, 1.5), 0.0);
+        chopper.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
+        chopper.AddComponent<SpriteComponent>("chopper-image", tileSize, tileSize, 3);
+        chopper.AddComponent<AnimationComponent>(2, 15, true);
+
+        Entity radar = levelRegistry->CreateEntity();
+        radar.AddComponent<TransformComponent>(glm::vec2(windowWidth - 100, 10.0), glm::vec2(1.5, 1.5), 0.0);
+        radar.AddComponent<RigidBodyComponent>(glm::vec2(0.0, 0.0));
+        radar.AddComponent<SpriteComponent>("radar-image", 64, 64, 2);
+        radar.AddComponent<AnimationComponent>(8, 5, true);
+
+        Entity tank = levelRegistry->CreateEntity();
+        tank.AddComponent<TransformComponent>(glm::vec2(500.0, 10.0), glm::vec2(1.5, 1.5), 0.0);
+        tank.AddComponent<RigidBodyComponent>(glm::vec2(-30.0, 0.0));
+        tank.AddComponent<SpriteComponent>(tankSpriteId, tileSize, tileSize, 2);
+        tank.AddComponent<BoxColliderComponent>(32, 32);
+
+        Entity truck = levelRegistry->CreateEntity();
+        truck.AddComponent<TransformComponent>(glm::vec2(10.0, 10.0), glm::vec2(1.5, 1.5), 0.0);
+        truck.AddComponent<RigidBodyComponent>(glm::vec2(20.0, 0.0));
+        truck.AddComponent<SpriteComponent>("truck-image", tileSize, tileSize, 1);
+        truck.AddComponent<BoxColliderComponent>(32, 32);
+
+        return levelRegistry;
+    });
 }
 
 void Game::Setup()
 {
     LoadLevel(1);
+
+    // The systems stay subscribed for the whole game, their handles unsubscribe them when they go away
+    world.GetSystem<DamageSystem>().SubscribeToEvents(eventBus);
+    world.GetSystem<KeyBoardMovementSystem>().SubscribeToEvents(eventBus);
+
+    world.GetSystem<CollisionSystem>().SetJobSystem(&jobSystem);
 }
 
 void Game::Update()
@@ -179,21 +179,26 @@ void Game::Update()
     // Store the current frame time
     millisecondsPreviousFrame = SDL_GetTicks();
 
-    // Reset all event handlers for the current frame
-    eventBus.Reset();
-
-    // Perform the subscription of the events for all systems
-    registry.GetSystem<DamageSystem>().SubscribeToEvents(eventBus);
-    registry.GetSystem<KeyBoardMovementSystem>().SubscribeToEvents(eventBus);
+    // Bring in the level built in the background as soon as it is ready
+    if (pendingLevel.valid() && pendingLevel.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        auto levelRegistry = pendingLevel.get();
+        registry.Swap(*levelRegistry);
+    }
 
     // Update the registry to process the entities that are waiting to be created/deleted
     registry.Update();
 
     // Ask all the systems to update
-    registry.GetSystem<MovementSystem>().Update(deltaTime);
-    registry.GetSystem<AnimationSystem>().Update();
-    registry.GetSystem<CollisionSystem>().Update(eventBus);
-    registry.GetSystem<KeyBoardMovementSystem>().Update();
+    world.Update<MovementSystem>(deltaTime);
+    world.Update<AnimationSystem>();
+    world.Update<CollisionSystem>(eventBus);
+    eventBus.Dispatch<CollisionEnterEvent>();
+    eventBus.Dispatch<CollisionStayEvent>();
+    eventBus.Dispatch<CollisionExitEvent>();
+    world.Update<KeyBoardMovementSystem>();
+
+    eventBus.EndFrame();
 }
 
 void Game::Render()
@@ -202,10 +207,10 @@ void Game::Render()
     SDL_RenderClear(renderer);
 
     // Invoke all the systems that need to render
-    registry.GetSystem<RenderSystem>().Update(renderer, assetStore);
+    world.Update<RenderSystem>(renderer, assetStore);
     if (isDebugging)
     {
-        registry.GetSystem<RenderColliderSystem>().Update(renderer);
+        world.Update<RenderColliderSystem>(renderer);
     }
     SDL_RenderPresent(renderer);
 }
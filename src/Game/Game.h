@@ -2,15 +2,36 @@
 #define GAME_H
 
 #include "../ECS/ECS.h"
+#include "../ECS/World.h"
+#include <future>
+#include <memory>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include "glm/glm.hpp"
 #include "../AssetStore/AssetStore.h"
 #include "../EventBus/EventBus.h"
+#include "../Jobs/JobSystem.h"
+#include "../Systems/MovementSystem.h"
+#include "../Systems/RenderSystem.h"
+#include "../Systems/AnimationSystem.h"
+#include "../Systems/CollisionSystem.h"
+#include "../Systems/RenderColliderSystem.h"
+#include "../Systems/DamageSystem.h"
+#include "../Systems/KeyBoardmovementSystem.h"
 
 constexpr int FPS = 60;
 constexpr int MILLISECS_PER_FRAME = 1000 / FPS;
 
+// The systems processed in our game, fixed at compile time
+using GameWorld = World<
+    MovementSystem,
+    RenderSystem,
+    AnimationSystem,
+    CollisionSystem,
+    RenderColliderSystem,
+    DamageSystem,
+    KeyBoardMovementSystem>;
+
 class Game
 {
 private:
@@ -20,9 +41,17 @@ private:
     SDL_Window *window = nullptr;
     SDL_Renderer *renderer = nullptr;
 
+    // Declared before the world so it outlives the subscriptions held by the systems
+    EventBus eventBus;
+    // Shares the collision search across the cores, declared before the world for the same reason
+    JobSystem jobSystem;
     Registry registry;
+    GameWorld world{registry};
     AssetStore assetStore;
-    EventBus eventBus;
+
+    // Level entities being built in their own registry on a worker thread,
+    // declared after registry so it is waited on before the registry goes away
+    std::future<std::unique_ptr<Registry>> pendingLevel;
 
 public:
     Game();
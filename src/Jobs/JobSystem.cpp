@@ -0,0 +1,85 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem(std::size_t workerCount) {
+    for(std::size_t i = 0; i < workerCount; i++) {
+        // Thread index 0 is the one calling ParallelFor
+        workers.emplace_back([this, i]() { runWorker(i + 1); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStopping = true;
+    }
+    batchReady.notify_all();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::size_t JobSystem::GetDefaultWorkerCount() {
+    const auto hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+std::size_t JobSystem::GetThreadCount() const {
+    return workers.size() + 1;
+}
+
+void JobSystem::runChunks(Batch& batch, std::size_t threadIndex) {
+    while(true) {
+        const auto begin = batch.nextBegin.fetch_add(batch.grainSize);
+        if(begin >= batch.count) {
+            return;
+        }
+        batch.invoke(batch.job, begin, std::min(begin + batch.grainSize, batch.count), threadIndex);
+    }
+}
+
+void JobSystem::run(Batch& batch) {
+    // Not worth waking the workers for a single chunk
+    if(workers.empty() || batch.count <= batch.grainSize) {
+        runChunks(batch, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentBatch = &batch;
+        batchSerial++;
+        busyWorkers = workers.size();
+    }
+    batchReady.notify_all();
+
+    runChunks(batch, 0);
+
+    // The batch lives on our stack, wait for every worker to let go of it
+    std::unique_lock<std::mutex> lock(mutex);
+    batchDone.wait(lock, [this]() { return busyWorkers == 0; });
+    currentBatch = nullptr;
+}
+
+void JobSystem::runWorker(std::size_t threadIndex) {
+    std::uint64_t lastSerial = 0;
+    while(true) {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchReady.wait(lock, [&]() { return isStopping || batchSerial != lastSerial; });
+            if(isStopping) {
+                return;
+            }
+            lastSerial = batchSerial;
+            batch = currentBatch;
+        }
+
+        runChunks(*batch, threadIndex);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--busyWorkers == 0) {
+            batchDone.notify_one();
+        }
+    }
+}
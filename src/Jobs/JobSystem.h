@@ -0,0 +1,74 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*******************************************
+ JobSystem
+******************************************
+ A fixed set of worker threads sharing the chunks of a ParallelFor with
+ the thread calling it. The workers sleep between calls, so it suits a few
+ large batches per frame rather than many small jobs
+*******************************************/
+class JobSystem {
+    public:
+        // Spawns workerCount threads, with 0 every ParallelFor runs on the calling thread
+        explicit JobSystem(std::size_t workerCount = GetDefaultWorkerCount());
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // One worker per hardware thread besides the calling one
+        static std::size_t GetDefaultWorkerCount();
+
+        // Threads running the chunks of a ParallelFor, the calling one included
+        std::size_t GetThreadCount() const;
+
+        // Calls job(begin, end, threadIndex) on chunks of at most grainSize items
+        // covering [0, count), and returns once all of them ran. threadIndex is
+        // below GetThreadCount() and no two chunks running at the same time share
+        // it, so it can pick a per-thread buffer. Not to be called from a job
+        template <typename TJob>
+        void ParallelFor(std::size_t count, std::size_t grainSize, TJob&& job) {
+            Batch batch;
+            batch.count = count;
+            batch.grainSize = grainSize > 0 ? grainSize : 1;
+            batch.job = &job;
+            batch.invoke = [](void* job, std::size_t begin, std::size_t end, std::size_t threadIndex) {
+                (*static_cast<TJob*>(job))(begin, end, threadIndex);
+            };
+            run(batch);
+        }
+
+    private:
+        struct Batch {
+            std::size_t count = 0;
+            std::size_t grainSize = 1;
+            void* job = nullptr;
+            void (*invoke)(void* job, std::size_t begin, std::size_t end, std::size_t threadIndex) = nullptr;
+            std::atomic<std::size_t> nextBegin{0};
+        };
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable batchReady;
+        std::condition_variable batchDone;
+        // Guarded by mutex
+        Batch* currentBatch = nullptr;
+        std::uint64_t batchSerial = 0;
+        std::size_t busyWorkers = 0;
+        bool isStopping = false;
+
+        void run(Batch& batch);
+        void runWorker(std::size_t threadIndex);
+        static void runChunks(Batch& batch, std::size_t threadIndex);
+};
+
+#endif
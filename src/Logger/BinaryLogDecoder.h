@@ -0,0 +1,206 @@
+#ifndef BINARYLOGDECODER_H
+#define BINARYLOGDECODER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "BinaryLogFormat.h"
+#include "LogClock.h"
+
+///////////////////////////////////////////////////
+// Binary log decoding
+////////////////////////////////////////////////////
+// Reads back the files written by BinaryLogSink, used by the logdecode tool
+// and the tests. See BinaryLogFormat.h for the layout.
+////////////////////////////////////////////////////
+struct DecodedArgument {
+    BinaryLogArgType type;
+    std::int64_t intValue = 0;
+    std::uint64_t uintValue = 0;
+    double floatValue = 0.0;
+    std::string text;
+};
+
+struct DecodedMessage {
+    std::uint32_t formatId;
+    std::uint8_t level;
+    std::uint32_t category;
+    std::int64_t time;
+    std::vector<DecodedArgument> arguments;
+};
+
+struct DecodedLog {
+    std::uint32_t version = 0;
+    LogClockAnchor anchor;
+    std::unordered_map<std::uint32_t, std::string> formats;
+    std::unordered_map<std::uint32_t, std::string> strings;
+    std::vector<DecodedMessage> messages;
+    // False when the log ends with a corrupted or partial record
+    bool isComplete = true;
+};
+
+enum class BinaryLogDecodeResult {
+    OK,
+    NOT_A_LOG,
+    UNSUPPORTED_VERSION
+};
+
+class LogReader {
+    private:
+        const std::vector<char>& data;
+        std::size_t offset;
+
+    public:
+        LogReader(const std::vector<char>& data, std::size_t offset) : data{data}, offset{offset} {}
+
+        bool HasBytes(std::size_t count) const {
+            return offset + count <= data.size();
+        }
+
+        template <typename T>
+        bool Read(T& value) {
+            if(!HasBytes(sizeof(T))) {
+                return false;
+            }
+            std::memcpy(&value, data.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        bool ReadText(std::string& text, std::size_t length) {
+            if(!HasBytes(length)) {
+                return false;
+            }
+            text.assign(data.data() + offset, length);
+            offset += length;
+            return true;
+        }
+};
+
+inline bool ReadLogArgument(LogReader& reader, DecodedArgument& argument) {
+    if(!reader.Read(argument.type)) {
+        return false;
+    }
+    switch (argument.type)
+    {
+    case BinaryLogArgType::INT:
+        return reader.Read(argument.intValue);
+    case BinaryLogArgType::UINT:
+        return reader.Read(argument.uintValue);
+    case BinaryLogArgType::FLOAT:
+        return reader.Read(argument.floatValue);
+    case BinaryLogArgType::BOOL: {
+        std::uint8_t value = 0;
+        const bool isRead = reader.Read(value);
+        argument.uintValue = value;
+        return isRead;
+    }
+    case BinaryLogArgType::STRING: {
+        std::uint32_t id = 0;
+        const bool isRead = reader.Read(id);
+        argument.uintValue = id;
+        return isRead;
+    }
+    case BinaryLogArgType::INLINE_STRING: {
+        std::uint16_t length;
+        return reader.Read(length) && reader.ReadText(argument.text, length);
+    }
+    }
+    return false;
+}
+
+// Reads every record of data into log, stopping at the first corrupted one
+inline BinaryLogDecodeResult DecodeBinaryLog(const std::vector<char>& data, DecodedLog& log) {
+    if(data.size() < BINARY_LOG_HEADER_SIZE || std::memcmp(data.data(), BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) != 0) {
+        return BinaryLogDecodeResult::NOT_A_LOG;
+    }
+    std::memcpy(&log.version, data.data() + sizeof(BINARY_LOG_MAGIC), sizeof(log.version));
+    if(log.version != BINARY_LOG_VERSION) {
+        return BinaryLogDecodeResult::UNSUPPORTED_VERSION;
+    }
+
+    // Timestamps are monotonic nanoseconds of the writing process, its anchor gives their wall time
+    std::memcpy(&log.anchor.monotonicNs, data.data() + BINARY_LOG_ANCHOR_OFFSET, sizeof(log.anchor.monotonicNs));
+    std::memcpy(&log.anchor.realtimeNs, data.data() + BINARY_LOG_ANCHOR_OFFSET + sizeof(log.anchor.monotonicNs), sizeof(log.anchor.realtimeNs));
+
+    LogReader reader(data, BINARY_LOG_HEADER_SIZE);
+    BinaryLogRecordKind kind;
+    while(reader.Read(kind) && kind != BinaryLogRecordKind::END) {
+        if(kind == BinaryLogRecordKind::FORMAT || kind == BinaryLogRecordKind::STRING) {
+            std::uint32_t id;
+            std::uint16_t length;
+            std::string text;
+            if(!reader.Read(id) || !reader.Read(length) || !reader.ReadText(text, length)) {
+                log.isComplete = false;
+                break;
+            }
+            (kind == BinaryLogRecordKind::FORMAT ? log.formats : log.strings)[id] = text;
+        } else if(kind == BinaryLogRecordKind::MESSAGE) {
+            DecodedMessage message;
+            std::uint8_t argumentCount = 0;
+            bool isValid = reader.Read(message.formatId) && reader.Read(message.level) &&
+                reader.Read(message.category) && reader.Read(message.time) && reader.Read(argumentCount);
+            for(int i = 0; isValid && i < argumentCount; i++) {
+                DecodedArgument argument;
+                isValid = ReadLogArgument(reader, argument);
+                message.arguments.push_back(argument);
+            }
+            if(!isValid) {
+                log.isComplete = false;
+                break;
+            }
+            log.messages.push_back(message);
+        } else {
+            log.isComplete = false;
+            break;
+        }
+    }
+    return BinaryLogDecodeResult::OK;
+}
+
+inline std::string FormatLogArgument(const DecodedArgument& argument, const std::unordered_map<std::uint32_t, std::string>& strings) {
+    switch (argument.type)
+    {
+    case BinaryLogArgType::INT:
+        return std::to_string(argument.intValue);
+    case BinaryLogArgType::UINT:
+        return std::to_string(argument.uintValue);
+    case BinaryLogArgType::FLOAT:
+        return std::to_string(argument.floatValue);
+    case BinaryLogArgType::BOOL:
+        return argument.uintValue ? "true" : "false";
+    case BinaryLogArgType::STRING: {
+        auto text = strings.find(static_cast<std::uint32_t>(argument.uintValue));
+        return text != strings.end() ? text->second : "<unknown string " + std::to_string(argument.uintValue) + ">";
+    }
+    case BinaryLogArgType::INLINE_STRING:
+        return argument.text;
+    }
+    return "<bad argument>";
+}
+
+// Text of a decoded message, with the same placeholder substitution as Logger::Write
+inline std::string FormatLogMessage(const DecodedLog& log, const DecodedMessage& message) {
+    auto format = log.formats.find(message.formatId);
+    if(format == log.formats.end()) {
+        return "<unknown format " + std::to_string(message.formatId) + ">";
+    }
+
+    std::string text;
+    std::size_t position = 0;
+    for(const auto& argument: message.arguments) {
+        const auto placeholder = format->second.find("{}", position);
+        if(placeholder == std::string::npos) {
+            break;
+        }
+        text.append(format->second, position, placeholder - position);
+        text += FormatLogArgument(argument, log.strings);
+        position = placeholder + 2;
+    }
+    text.append(format->second, position, std::string::npos);
+    return text;
+}
+
+#endif
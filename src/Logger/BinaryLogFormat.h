@@ -0,0 +1,43 @@
+#ifndef BINARYLOGFORMAT_H
+#define BINARYLOGFORMAT_H
+
+#include <cstdint>
+
+///////////////////////////////////////////////////
+// Binary log format
+////////////////////////////////////////////////////
+// Shared by BinaryLogSink and the logdecode tool. A file starts with
+// BINARY_LOG_MAGIC, the format version and the LogClock anchor of the writing
+// process (i64 monotonic ns, i64 unix time ns), followed by packed records
+// (no padding, little endian) each starting with a BinaryLogRecordKind:
+//   FORMAT:  u32 format id, u16 length, format string bytes
+//   STRING:  u32 string id, u16 length, string bytes
+//   MESSAGE: u32 format id, u8 level, u32 category, i64 monotonic ns,
+//            u8 argument count, then per argument a BinaryLogArgType and:
+//            INT i64 | UINT u64 | FLOAT f64 | BOOL u8 | STRING u32 string id |
+//            INLINE_STRING u16 length + bytes
+// Unused space is zero filled, so a zero kind marks the end of the log.
+// Definitions may follow the messages using them when threads race.
+////////////////////////////////////////////////////
+constexpr char BINARY_LOG_MAGIC[8] = {'P', 'K', 'B', 'L', 'O', 'G', '\0', '\0'};
+constexpr std::uint32_t BINARY_LOG_VERSION = 2;
+constexpr std::uint32_t BINARY_LOG_ANCHOR_OFFSET = sizeof(BINARY_LOG_MAGIC) + sizeof(BINARY_LOG_VERSION);
+constexpr std::uint32_t BINARY_LOG_HEADER_SIZE = BINARY_LOG_ANCHOR_OFFSET + 2 * sizeof(std::int64_t);
+
+enum class BinaryLogRecordKind : std::uint8_t {
+    END = 0,
+    FORMAT = 1,
+    STRING = 2,
+    MESSAGE = 3
+};
+
+enum class BinaryLogArgType : std::uint8_t {
+    INT = 1,
+    UINT = 2,
+    FLOAT = 3,
+    BOOL = 4,
+    STRING = 5,
+    INLINE_STRING = 6
+};
+
+#endif
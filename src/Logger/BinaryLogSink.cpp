@@ -0,0 +1,165 @@
+#include "BinaryLogSink.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+std::atomic<std::uint32_t> BinaryLogSink::nextGeneration{1};
+
+BinaryLogSink::~BinaryLogSink() {
+    Close();
+}
+
+bool BinaryLogSink::Open(const std::string& path, std::size_t capacityBytes) {
+    Close();
+
+    fileDescriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fileDescriptor < 0) {
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if(ftruncate(fileDescriptor, capacityBytes) == 0) {
+        mapping = mmap(nullptr, capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    }
+    if(mapping == MAP_FAILED) {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+
+    mappedFile = static_cast<char*>(mapping);
+    capacity = capacityBytes;
+    std::memcpy(mappedFile, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+    std::memcpy(mappedFile + sizeof(BINARY_LOG_MAGIC), &BINARY_LOG_VERSION, sizeof(BINARY_LOG_VERSION));
+    const auto& anchor = LogClock::GetAnchor();
+    std::memcpy(mappedFile + BINARY_LOG_ANCHOR_OFFSET, &anchor.monotonicNs, sizeof(anchor.monotonicNs));
+    std::memcpy(mappedFile + BINARY_LOG_ANCHOR_OFFSET + sizeof(anchor.monotonicNs), &anchor.realtimeNs, sizeof(anchor.realtimeNs));
+    writeOffset = BINARY_LOG_HEADER_SIZE;
+    droppedCount = 0;
+
+    formatIds.clear();
+    stringIds.clear();
+    isStringTableFull = false;
+    generation = nextGeneration++;
+    return true;
+}
+
+void BinaryLogSink::Close() {
+    if(!mappedFile) {
+        return;
+    }
+
+    const auto used = std::min<std::size_t>(writeOffset, capacity);
+    munmap(mappedFile, capacity);
+    if(ftruncate(fileDescriptor, used) != 0) {
+        // Keep the full size file, the zero filled tail still ends the log
+    }
+    close(fileDescriptor);
+
+    mappedFile = nullptr;
+    fileDescriptor = -1;
+    capacity = 0;
+}
+
+char* BinaryLogSink::reserve(std::size_t size) {
+    const auto offset = writeOffset.fetch_add(size, std::memory_order_relaxed);
+    if(offset + size > capacity) {
+        droppedCount++;
+        return nullptr;
+    }
+    return mappedFile + offset;
+}
+
+void BinaryLogSink::writeDefinition(BinaryLogRecordKind kind, std::uint32_t id, const char* text, std::size_t length) {
+    length = std::min<std::size_t>(length, UINT16_MAX);
+    char* out = reserve(1 + sizeof(std::uint32_t) + sizeof(std::uint16_t) + length);
+    if(!out) {
+        return;
+    }
+    put(out, kind);
+    put(out, id);
+    put<std::uint16_t>(out, length);
+    std::memcpy(out, text, length);
+}
+
+std::uint32_t BinaryLogSink::InternFormat(const char* format) {
+    struct Cache {
+        std::uint32_t generation = 0;
+        std::unordered_map<const char*, std::uint32_t> ids;
+    };
+    thread_local Cache cache;
+    if(cache.generation != generation) {
+        cache.ids.clear();
+        cache.generation = generation;
+    }
+
+    auto cached = cache.ids.find(format);
+    if(cached != cache.ids.end()) {
+        return cached->second;
+    }
+
+    std::lock_guard<std::mutex> lock(internMutex);
+    auto interned = formatIds.find(format);
+    if(interned == formatIds.end()) {
+        const auto id = static_cast<std::uint32_t>(formatIds.size());
+        interned = formatIds.emplace(format, id).first;
+        writeDefinition(BinaryLogRecordKind::FORMAT, id, format, std::strlen(format));
+    }
+    cache.ids.emplace(format, interned->second);
+    return interned->second;
+}
+
+std::uint32_t BinaryLogSink::InternString(const std::string& text) {
+    struct Cache {
+        std::uint32_t generation = 0;
+        std::unordered_map<std::string, std::uint32_t> ids;
+    };
+    thread_local Cache cache;
+    if(cache.generation != generation) {
+        cache.ids.clear();
+        cache.generation = generation;
+    }
+
+    auto cached = cache.ids.find(text);
+    if(cached != cache.ids.end()) {
+        return cached->second;
+    }
+    if(isStringTableFull.load(std::memory_order_acquire)) {
+        return INLINE_STRING_ID;
+    }
+
+    std::lock_guard<std::mutex> lock(internMutex);
+    auto interned = stringIds.find(text);
+    if(interned == stringIds.end()) {
+        if(stringIds.size() >= MAX_INTERNED_STRINGS) {
+            isStringTableFull.store(true, std::memory_order_release);
+            return INLINE_STRING_ID;
+        }
+        const auto id = static_cast<std::uint32_t>(stringIds.size());
+        interned = stringIds.emplace(text, id).first;
+        writeDefinition(BinaryLogRecordKind::STRING, id, text.data(), text.size());
+    }
+    cache.ids.emplace(text, interned->second);
+    return interned->second;
+}
+
+void BinaryLogSink::WriteText(std::uint8_t level, std::uint32_t category, const std::string& text) {
+    const auto formatId = InternFormat("{}");
+    const std::int64_t time = LogClock::Now();
+    const auto length = static_cast<std::uint16_t>(std::min<std::size_t>(text.size(), UINT16_MAX));
+
+    char* out = reserve(1 + sizeof(std::uint32_t) + 1 + sizeof(std::uint32_t) + sizeof(std::int64_t) + 1 +
+        1 + sizeof(std::uint16_t) + length);
+    if(!out) {
+        return;
+    }
+    put(out, BinaryLogRecordKind::MESSAGE);
+    put(out, formatId);
+    put(out, level);
+    put(out, category);
+    put(out, time);
+    put<std::uint8_t>(out, 1);
+    put(out, BinaryLogArgType::INLINE_STRING);
+    put(out, length);
+    std::memcpy(out, text.data(), length);
+}
@@ -0,0 +1,180 @@
+#ifndef BINARYLOGSINK_H
+#define BINARYLOGSINK_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include "BinaryLogFormat.h"
+#include "LogClock.h"
+
+///////////////////////////////////////////////////
+// BinaryLogSink
+////////////////////////////////////////////////////
+// Appends log messages to a memory-mapped file as a format id plus the raw
+// arguments, nothing is formatted. Writers reserve their bytes with one
+// atomic add and copy them in, so any thread can write without locking.
+// Format and string arguments are interned: they are written once as a
+// definition record and referred to by id afterwards. Past MAX_INTERNED_STRINGS
+// strings are written inline instead, so dynamic strings (names, paths...)
+// cannot grow the table for the whole run. Use the logdecode tool to turn the
+// file back into text.
+////////////////////////////////////////////////////
+class BinaryLogSink {
+    private:
+        char* mappedFile = nullptr;
+        std::size_t capacity = 0;
+        std::atomic<std::size_t> writeOffset{0};
+        std::atomic<std::uint64_t> droppedCount{0};
+        int fileDescriptor = -1;
+        // Changes on every Open() so thread local intern caches of a previous file are dropped
+        std::atomic<std::uint32_t> generation{0};
+        static std::atomic<std::uint32_t> nextGeneration;
+
+        // Only locked the first time a thread meets a format or string
+        std::mutex internMutex;
+        // By content, so the copies of a literal in several translation units share an id
+        std::unordered_map<std::string, std::uint32_t> formatIds;
+        std::unordered_map<std::string, std::uint32_t> stringIds;
+        // Set once stringIds reached MAX_INTERNED_STRINGS, read without the lock
+        std::atomic<bool> isStringTableFull{false};
+
+        // Reserves size bytes of the file, nullptr (and a dropped message) when full
+        char* reserve(std::size_t size);
+        void writeDefinition(BinaryLogRecordKind kind, std::uint32_t id, const char* text, std::size_t length);
+
+        template <typename T>
+        static void put(char*& out, T value) {
+            std::memcpy(out, &value, sizeof(T));
+            out += sizeof(T);
+        }
+
+        template <typename TArg>
+        static constexpr bool isString() {
+            return std::is_convertible<const TArg&, std::string>::value && !std::is_same<TArg, bool>::value;
+        }
+
+        template <typename TArg>
+        std::size_t argumentSize(const TArg& arg) {
+            if constexpr (std::is_same<TArg, bool>::value) {
+                return 1 + sizeof(std::uint8_t);
+            } else if constexpr (std::is_integral<TArg>::value || std::is_floating_point<TArg>::value) {
+                return 1 + sizeof(std::uint64_t);
+            } else {
+                static_assert(isString<TArg>(), "Binary log arguments must be numbers, bools or strings");
+                const std::string& text = arg;
+                if(InternString(text) == INLINE_STRING_ID) {
+                    return 1 + sizeof(std::uint16_t) + inlineLength(text);
+                }
+                return 1 + sizeof(std::uint32_t);
+            }
+        }
+
+        static std::uint16_t inlineLength(const std::string& text) {
+            return static_cast<std::uint16_t>(std::min<std::size_t>(text.size(), UINT16_MAX));
+        }
+
+        template <typename TArg>
+        void putArgument(char*& out, const TArg& arg) {
+            if constexpr (std::is_same<TArg, bool>::value) {
+                put(out, BinaryLogArgType::BOOL);
+                put<std::uint8_t>(out, arg ? 1 : 0);
+            } else if constexpr (std::is_floating_point<TArg>::value) {
+                put(out, BinaryLogArgType::FLOAT);
+                put<double>(out, arg);
+            } else if constexpr (std::is_integral<TArg>::value && std::is_signed<TArg>::value) {
+                put(out, BinaryLogArgType::INT);
+                put<std::int64_t>(out, arg);
+            } else if constexpr (std::is_integral<TArg>::value) {
+                put(out, BinaryLogArgType::UINT);
+                put<std::uint64_t>(out, arg);
+            } else {
+                // Same answer as in argumentSize(), a string is never interned once the table is full
+                const std::string& text = arg;
+                const auto id = InternString(text);
+                if(id == INLINE_STRING_ID) {
+                    const auto length = inlineLength(text);
+                    put(out, BinaryLogArgType::INLINE_STRING);
+                    put(out, length);
+                    std::memcpy(out, text.data(), length);
+                    out += length;
+                } else {
+                    put(out, BinaryLogArgType::STRING);
+                    put<std::uint32_t>(out, id);
+                }
+            }
+        }
+
+    public:
+        // Distinct strings interned per file, and the id InternString() returns past them
+        static constexpr std::size_t MAX_INTERNED_STRINGS = 1024;
+        static constexpr std::uint32_t INLINE_STRING_ID = UINT32_MAX;
+
+        BinaryLogSink() = default;
+        ~BinaryLogSink();
+
+        // Maps a file of capacityBytes at path and starts a new log in it.
+        // Neither Open() nor Close() may run while other threads write
+        bool Open(const std::string& path, std::size_t capacityBytes);
+        // Unmaps the file and trims it to the bytes written
+        void Close();
+
+        bool IsOpen() const {
+            return mappedFile != nullptr;
+        }
+
+        // Messages that did not fit in the file
+        std::uint64_t GetDroppedCount() const {
+            return droppedCount;
+        }
+
+        // Ids of a format string and of a string, both by content. Each thread
+        // also caches format ids by address, so format must be a literal.
+        // Strings get INLINE_STRING_ID once the table is full
+        std::uint32_t InternFormat(const char* format);
+        std::uint32_t InternString(const std::string& text);
+
+        // Whether Write() can store the arguments raw: numbers, bools and strings.
+        // A char would come back as a number, it is left to the text formatting
+        template <typename ...TArgs>
+        static constexpr bool CanWrite() {
+            return (... && (!std::is_same<TArgs, char>::value &&
+                (std::is_arithmetic<TArgs>::value || isString<TArgs>())));
+        }
+
+        // Appends a message whose arguments are numbers, bools or strings
+        template <typename ...TArgs>
+        void Write(std::uint8_t level, std::uint32_t category, const char* format, const TArgs& ...args);
+
+        // Appends a message made of an already formatted text, stored inline
+        void WriteText(std::uint8_t level, std::uint32_t category, const std::string& text);
+};
+
+template <typename ...TArgs>
+void BinaryLogSink::Write(std::uint8_t level, std::uint32_t category, const char* format, const TArgs& ...args) {
+    static_assert(sizeof...(TArgs) < 256, "Too many binary log arguments");
+
+    const auto formatId = InternFormat(format);
+    const std::int64_t time = LogClock::Now();
+
+    const std::size_t size = 1 + sizeof(std::uint32_t) + 1 + sizeof(std::uint32_t) + sizeof(std::int64_t) + 1 +
+        (std::size_t{0} + ... + argumentSize(args));
+
+    char* out = reserve(size);
+    if(!out) {
+        return;
+    }
+    put(out, BinaryLogRecordKind::MESSAGE);
+    put(out, formatId);
+    put(out, level);
+    put(out, category);
+    put(out, time);
+    put<std::uint8_t>(out, sizeof...(TArgs));
+    (putArgument(out, args), ...);
+}
+
+#endif
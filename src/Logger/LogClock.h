@@ -0,0 +1,65 @@
+#ifndef LOGCLOCK_H
+#define LOGCLOCK_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// Pairs a reading of the monotonic clock with the wall clock at the same moment
+struct LogClockAnchor {
+    std::int64_t monotonicNs;
+    std::int64_t realtimeNs;
+};
+
+///////////////////////////////////////////////////
+// LogClock
+////////////////////////////////////////////////////
+// Log timestamps are raw CLOCK_MONOTONIC nanoseconds, cheap to take and
+// fine enough to line log messages up with frame timings. They are turned
+// into local wall time through an anchor when formatted, and the date and
+// time part is cached so only the sub-second digits change between messages.
+////////////////////////////////////////////////////
+class LogClock {
+    private:
+        static std::int64_t read(clockid_t clock) {
+            timespec now;
+            clock_gettime(clock, &now);
+            return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+        }
+
+    public:
+        static std::int64_t Now() {
+            return read(CLOCK_MONOTONIC);
+        }
+
+        // Taken on first use, shared by every timestamp of the process
+        static const LogClockAnchor& GetAnchor() {
+            static const LogClockAnchor anchor{read(CLOCK_MONOTONIC), read(CLOCK_REALTIME)};
+            return anchor;
+        }
+
+        // Local time of a monotonic timestamp as "YYYY-mm-dd HH:MM:SS.uuuuuu"
+        static std::string Format(std::int64_t monotonicNs, const LogClockAnchor& anchor = GetAnchor()) {
+            thread_local std::time_t cachedSecond = -1;
+            thread_local char cachedPrefix[32] = "";
+
+            const auto realtimeNs = anchor.realtimeNs + (monotonicNs - anchor.monotonicNs);
+            const std::time_t second = realtimeNs / 1000000000;
+            if(second != cachedSecond) {
+                std::tm localTime;
+                localtime_r(&second, &localTime);
+                std::strftime(cachedPrefix, sizeof(cachedPrefix), "%Y-%m-%d %H:%M:%S", &localTime);
+                cachedSecond = second;
+            }
+
+            char microseconds[] = ".000000";
+            auto remainder = (realtimeNs % 1000000000) / 1000;
+            for(int digit = 6; digit > 0; digit--) {
+                microseconds[digit] = static_cast<char>('0' + remainder % 10);
+                remainder /= 10;
+            }
+            return std::string(cachedPrefix) + microseconds;
+        }
+};
+
+#endif
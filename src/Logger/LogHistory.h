@@ -0,0 +1,76 @@
+#ifndef LOGHISTORY_H
+#define LOGHISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "Logger.h"
+
+///////////////////////////////////////////////////
+// LogHistory
+////////////////////////////////////////////////////
+// Ring buffer holding the last written records within a byte budget.
+// Its storage is allocated once per budget: when full, the oldest record
+// is overwritten and counted instead of growing the buffer.
+////////////////////////////////////////////////////
+class LogHistory {
+    private:
+        mutable std::mutex mutex;
+        std::vector<LogRecord> records;
+        // Index of the oldest record and number of stored records
+        std::size_t head = 0;
+        std::size_t size = 0;
+        std::uint64_t overwrittenCount = 0;
+
+    public:
+        explicit LogHistory(std::size_t byteBudget) {
+            SetByteBudget(byteBudget);
+        }
+
+        // Drops the stored records and makes room for as many as fit in byteBudget
+        void SetByteBudget(std::size_t byteBudget) {
+            std::lock_guard<std::mutex> lock(mutex);
+            records = std::vector<LogRecord>(std::max<std::size_t>(byteBudget / sizeof(LogRecord), 1));
+            head = 0;
+            size = 0;
+        }
+
+        void Add(const LogRecord& record) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(size < records.size()) {
+                records[(head + size) % records.size()] = record;
+                size++;
+            } else {
+                records[head] = record;
+                head = (head + 1) % records.size();
+                overwrittenCount++;
+            }
+        }
+
+        // Calls f(const LogRecord&) on every stored record, oldest first
+        template <typename F>
+        void ForEach(F&& f) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            for(std::size_t i = 0; i < size; i++) {
+                f(records[(head + i) % records.size()]);
+            }
+        }
+
+        std::size_t GetCapacity() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return records.size();
+        }
+
+        std::size_t GetSize() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return size;
+        }
+
+        std::uint64_t GetOverwrittenCount() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return overwrittenCount;
+        }
+};
+
+#endif
@@ -1,50 +1,265 @@
 #include "Logger.h"
-
-std::vector<LogEntry> Logger::messages;
+#include "MpscRingBuffer.h"
+#include "LogHistory.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
 const std::string Logger::GREEN = "\033[32m";
 const std::string Logger::RED = "\033[31m";
+const std::string Logger::YELLOW = "\033[33m";
 const std::string Logger::RESET = "\033[0m";
 
+BinaryLogSink Logger::binarySink;
+std::atomic<LogType> Logger::minLevel{LogType::LOG_INFO};
+std::atomic<std::uint32_t> Logger::categoryMask{0xFFFFFFFF};
+
+constexpr std::size_t LOG_QUEUE_CAPACITY = 8192;
+
+// Owns the queue of pending records, the history and the thread writing them out
+struct Logger::Writer {
+    MpscRingBuffer<LogRecord, LOG_QUEUE_CAPACITY> queue;
+    LogHistory history{DEFAULT_HISTORY_BUDGET};
+    std::atomic<std::size_t> writtenCount{0};
+    std::atomic<std::uint64_t> truncatedCount{0};
+    std::atomic<bool> isRunning{true};
+    // The writer sleeps on wakeup while the queue is empty, producers only
+    // lock the mutex to notify it when isIdle is set. Flush() sleeps on drained
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::atomic<bool> isIdle{false};
+    std::atomic<int> flushWaiters{0};
+    // Started last, once the members it uses are constructed
+    std::thread thread;
+
+    Writer() : thread{[this]() { Run(); }} {}
+
+    ~Writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isRunning = false;
+        }
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    // Any thread, after a push. Either it sees the writer idle or the writer
+    // sees the push before going to sleep, the fences order both checks
+    void Wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(isIdle.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeup.notify_one();
+        }
+    }
+
+    void WaitForRecords() {
+        std::unique_lock<std::mutex> lock(mutex);
+        isIdle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wakeup.wait(lock, [this]() {
+            return !isRunning || queue.GetPushedCount() > writtenCount;
+        });
+        isIdle.store(false, std::memory_order_relaxed);
+    }
+
+    void Run() {
+        while(true) {
+            // Read before draining so nothing logged before a stop request is lost
+            const bool keepRunning = isRunning;
+
+            std::size_t count = 0;
+            while(queue.TryPop([this](const LogRecord& record) {
+                Logger::writeRecord(record);
+                history.Add(record);
+            })) {
+                count++;
+            }
+
+            if(count > 0) {
+                std::cout.flush();
+                writtenCount += count;
+                if(flushWaiters > 0) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    drained.notify_all();
+                }
+            } else if(!keepRunning) {
+                break;
+            } else {
+                WaitForRecords();
+            }
+        }
+    }
+};
+
+Logger::Writer& Logger::getWriter() {
+    static Writer writer;
+    return writer;
+}
+
 void Logger::Log(const std::string& message) {
-    logHelper(message, LogType::LOG_INFO);
+    if(IsEnabled(LogType::LOG_INFO, LogCategory::GENERAL)) {
+        logHelper(message, LogType::LOG_INFO);
+    }
+}
+
+void Logger::Warn(const std::string& message) {
+    if(IsEnabled(LogType::LOG_WARNING, LogCategory::GENERAL)) {
+        logHelper(message, LogType::LOG_WARNING);
+    }
 }
 
 void Logger::Err(const std::string& message) {
     logHelper(message, LogType::LOG_ERROR);
+    Flush();
 }
 
-void Logger::logHelper(const std::string& message, LogType logType) {
-    LogEntry logEntry;
-    logEntry.type = logType;
-    std::string color;
+void Logger::Flush() {
+    auto& writer = getWriter();
+    const auto target = writer.queue.GetPushedCount();
+    if(writer.writtenCount >= target) {
+        return;
+    }
+
+    writer.flushWaiters++;
+    writer.Wake();
+    {
+        std::unique_lock<std::mutex> lock(writer.mutex);
+        writer.drained.wait(lock, [&writer, target]() { return writer.writtenCount >= target; });
+    }
+    writer.flushWaiters--;
+}
+
+void Logger::SetLevel(LogType level) {
+    minLevel = level;
+}
+
+void Logger::SetCategoryEnabled(LogCategory category, bool isEnabled) {
+    if(isEnabled) {
+        categoryMask |= static_cast<std::uint32_t>(category);
+    } else {
+        categoryMask &= ~static_cast<std::uint32_t>(category);
+    }
+}
+
+void Logger::appendFormatted(std::string& out, const char* format) {
+    out += format;
+}
+
+bool Logger::OpenBinaryLog(const std::string& path, std::size_t capacityBytes) {
+    return binarySink.Open(path, capacityBytes);
+}
+
+void Logger::CloseBinaryLog() {
+    binarySink.Close();
+}
+
+void Logger::logHelper(const std::string& message, LogType logType, LogCategory category) {
+    if(binarySink.IsOpen()) {
+        binarySink.WriteText(static_cast<std::uint8_t>(logType), static_cast<std::uint32_t>(category), message);
+        if(logType != LogType::LOG_ERROR) {
+            return;
+        }
+    }
+    textHelper(message, logType, category);
+}
+
+void Logger::textHelper(const std::string& message, LogType logType, LogCategory category) {
+    const auto now = LogClock::Now();
+    const auto length = static_cast<std::uint32_t>(std::min(message.size(), LogRecord::MAX_MESSAGE_LENGTH));
+    const bool isTruncated = length < message.size();
+
+    auto fill = [&](LogRecord& record) {
+        record.type = logType;
+        record.category = category;
+        record.timestamp = now;
+        record.length = length;
+        record.isTruncated = isTruncated;
+        std::memcpy(record.message, message.data(), length);
+    };
+
+    auto& writer = getWriter();
+    if(isTruncated) {
+        writer.truncatedCount++;
+    }
+
+    // When the writer falls behind, wait for room rather than dropping messages
+    while(!writer.queue.TryPush(fill)) {
+        std::this_thread::yield();
+    }
+    writer.Wake();
+}
+
+void Logger::SetHistoryBudget(std::size_t bytes) {
+    getWriter().history.SetByteBudget(bytes);
+}
+
+std::vector<LogEntry> Logger::GetHistory() {
+    std::vector<LogEntry> entries;
+    getWriter().history.ForEach([&entries](const LogRecord& record) {
+        entries.push_back(LogEntry{record.type, formatRecord(record)});
+    });
+    return entries;
+}
+
+LogStats Logger::GetStats() {
+    auto& writer = getWriter();
+    LogStats stats;
+    stats.writtenCount = writer.writtenCount;
+    stats.truncatedCount = writer.truncatedCount;
+    stats.historyCapacity = writer.history.GetCapacity();
+    stats.historySize = writer.history.GetSize();
+    stats.historyOverwrittenCount = writer.history.GetOverwrittenCount();
+    return stats;
+}
+
+const std::string Logger::formatRecord(const LogRecord& record) {
     std::string logDesc;
 
-    switch (logType)
+    switch (record.type)
     {
     case LogType::LOG_ERROR:
-        color = RED;
         logDesc = "ERR";
         break;
+    case LogType::LOG_WARNING:
+        logDesc = "WRN";
+        break;
     case LogType::LOG_INFO:
-        color = GREEN;
         logDesc = "LOG";
         break;
-    default:
+    case LogType::LOG_DEBUG:
+        logDesc = "DBG";
+        break;
+    case LogType::LOG_TRACE:
+        logDesc = "TRC";
         break;
     }
 
-    logEntry.message = logDesc + " [ " + printTimeStamp() + " ] - " + message;
-    std::cout << color << logEntry.message << RESET << std::endl;
-    messages.push_back(logEntry);
+    return logDesc + " [ " + LogClock::Format(record.timestamp) + " ] - " +
+        std::string(record.message, record.length) + (record.isTruncated ? "..." : "");
 }
 
-const std::string Logger::printTimeStamp() {
-    // get current time
-    time_t now = std::time(nullptr);
-    
-    // format timestamp string
-    std::ostringstream oss;
-    oss << std::put_time(std::localtime(&now), "%Y-%m-%d %H:%M:%S");
-    return oss.str();
-}
\ No newline at end of file
+void Logger::writeRecord(const LogRecord& record) {
+    std::string color;
+
+    switch (record.type)
+    {
+    case LogType::LOG_ERROR:
+        color = RED;
+        break;
+    case LogType::LOG_WARNING:
+        color = YELLOW;
+        break;
+    case LogType::LOG_INFO:
+        color = GREEN;
+        break;
+    default:
+        break;
+    }
+
+    std::cout << color << formatRecord(record) << RESET << '\n';
+}
@@ -1,36 +1,237 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <ctime>
-#include <iomanip>
+#include <atomic>
+#include <cstdint>
 #include <sstream>
 #include <iostream>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
+#include "BinaryLogSink.h"
+#include "LogClock.h"
 
+// Severity levels, lowest first. The values match the LOG_COMPILE_LEVEL numbers
 enum class LogType {
+    LOG_TRACE,
+    LOG_DEBUG,
     LOG_INFO,
     LOG_WARNING,
     LOG_ERROR
 };
 
+// Bit flags used to enable or mute parts of the engine
+enum class LogCategory : std::uint32_t {
+    GENERAL = 1 << 0,
+    ECS = 1 << 1,
+    EVENTS = 1 << 2,
+    ASSETS = 1 << 3,
+    GAME = 1 << 4
+};
+
+// Lowest level compiled in: 0 trace, 1 debug, 2 info, 3 warning, 4 error.
+// Release builds (NDEBUG) drop the LOG_TRACE calls entirely
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 1
+#else
+#define LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
 struct LogEntry {
     LogType type;
     std::string message;
 };
 
+// Fixed-size message handed from the logging threads to the writer thread
+// and kept in the history, longer messages are truncated
+struct LogRecord {
+    static constexpr std::size_t MAX_MESSAGE_LENGTH = 228;
+
+    LogType type;
+    LogCategory category;
+    // CLOCK_MONOTONIC nanoseconds, see LogClock
+    std::int64_t timestamp;
+    std::uint32_t length;
+    bool isTruncated;
+    char message[MAX_MESSAGE_LENGTH];
+};
+
+struct LogStats {
+    // Records written out by the writer thread
+    std::uint64_t writtenCount;
+    // Messages cut to LogRecord::MAX_MESSAGE_LENGTH
+    std::uint64_t truncatedCount;
+    // History capacity and usage, and records dropped from it to make room
+    std::size_t historyCapacity;
+    std::size_t historySize;
+    std::uint64_t historyOverwrittenCount;
+};
+
+///////////////////////////////////////////////////
+// Logger
+////////////////////////////////////////////////////
+// Log(), Warn() and Err() only copy the message into a lock-free queue, a background
+// thread formats the queued records, prints them and keeps the last ones in
+// a history bounded by a byte budget (DEFAULT_HISTORY_BUDGET unless changed).
+////////////////////////////////////////////////////
 class Logger {
     public:
-        static std::vector<LogEntry> messages;
+        static constexpr std::size_t DEFAULT_HISTORY_BUDGET = 1024 * 1024;
+
         static void Log(const std::string& message);
+        static void Warn(const std::string& message);
+        // Errors are flushed before returning, they often precede a crash
         static void Err(const std::string& message);
 
+        // Blocks until every message logged so far has been written
+        static void Flush();
+
+        // Reallocates the history to hold as many records as fit in bytes,
+        // the records it held are dropped
+        static void SetHistoryBudget(std::size_t bytes);
+
+        // Messages in the history, oldest first (e.g. for an in-game console)
+        static std::vector<LogEntry> GetHistory();
+
+        static LogStats GetStats();
+
+        // Runtime filters, messages below the level or out of the enabled
+        // categories are skipped (default: info and above, every category)
+        static void SetLevel(LogType level);
+        static void SetCategoryEnabled(LogCategory category, bool isEnabled);
+
+        static bool IsEnabled(LogType level, LogCategory category) {
+            return level >= minLevel.load(std::memory_order_relaxed) &&
+                (categoryMask.load(std::memory_order_relaxed) & static_cast<std::uint32_t>(category)) != 0;
+        }
+
+        // Sends messages to a memory-mapped binary file instead of the text
+        // output (errors go to both), decode it with the logdecode tool
+        static bool OpenBinaryLog(const std::string& path, std::size_t capacityBytes);
+        static void CloseBinaryLog();
+
+        // Replaces every "{}" of format with the next argument and logs the
+        // result, prefer the LOG_* macros that skip it all when disabled.
+        // Arguments are numbers, bools, chars, strings or anything with an
+        // operator<<. With a binary log open the numbers, bools and strings are
+        // stored unformatted, messages with other arguments as formatted text
+        template <typename ...TArgs>
+        static void Write(LogType level, LogCategory category, const char* format, const TArgs& ...args);
+
     private:
-        static const std::string printTimeStamp();
-        static void logHelper(const std::string& msg, LogType logType);
+        static BinaryLogSink binarySink;
+        static std::atomic<LogType> minLevel;
+        static std::atomic<std::uint32_t> categoryMask;
+
+        static void appendFormatted(std::string& out, const char* format);
+        template <typename TArg, typename ...TArgs>
+        static void appendFormatted(std::string& out, const char* format, const TArg& arg, const TArgs& ...args);
+        template <typename TArg>
+        static void appendArgument(std::string& out, const TArg& arg);
+
+        struct Writer;
+        static Writer& getWriter();
+
+        static void logHelper(const std::string& msg, LogType logType, LogCategory category = LogCategory::GENERAL);
+        static void textHelper(const std::string& msg, LogType logType, LogCategory category);
+        static const std::string formatRecord(const LogRecord& record);
+        static void writeRecord(const LogRecord& record);
         static const std::string GREEN;
         static const std::string RED;
+        static const std::string YELLOW;
         static const std::string RESET;
 };
 
-#endif
\ No newline at end of file
+template <typename ...TArgs>
+void Logger::Write(LogType level, LogCategory category, const char* format, const TArgs& ...args) {
+    if(binarySink.IsOpen()) {
+        if constexpr (BinaryLogSink::CanWrite<TArgs...>()) {
+            binarySink.Write(static_cast<std::uint8_t>(level), static_cast<std::uint32_t>(category), format, args...);
+        } else {
+            // Arguments the binary format has no type for are formatted and stored as text
+            std::string message;
+            appendFormatted(message, format, args...);
+            binarySink.WriteText(static_cast<std::uint8_t>(level), static_cast<std::uint32_t>(category), message);
+        }
+        if(level != LogType::LOG_ERROR) {
+            return;
+        }
+    }
+
+    std::string message;
+    appendFormatted(message, format, args...);
+    textHelper(message, level, category);
+    if(level == LogType::LOG_ERROR) {
+        Flush();
+    }
+}
+
+template <typename TArg, typename ...TArgs>
+void Logger::appendFormatted(std::string& out, const char* format, const TArg& arg, const TArgs& ...args) {
+    const char* placeholder = std::strstr(format, "{}");
+    if(!placeholder) {
+        out += format;
+        return;
+    }
+    out.append(format, placeholder);
+    appendArgument(out, arg);
+    appendFormatted(out, placeholder + 2, args...);
+}
+
+template <typename TArg>
+void Logger::appendArgument(std::string& out, const TArg& arg) {
+    if constexpr (std::is_same<TArg, bool>::value) {
+        out += arg ? "true" : "false";
+    } else if constexpr (std::is_same<TArg, char>::value) {
+        out += arg;
+    } else if constexpr (std::is_integral<TArg>::value || std::is_floating_point<TArg>::value) {
+        out += std::to_string(arg);
+    } else if constexpr (std::is_convertible<const TArg&, std::string>::value) {
+        out += arg;
+    } else {
+        std::ostringstream oss;
+        oss << arg;
+        out += oss.str();
+    }
+}
+
+// Log macros: the arguments are neither evaluated nor formatted unless the
+// level and category are enabled, and levels below LOG_COMPILE_LEVEL compile
+// to nothing. Example: LOG_TRACE(LogCategory::ECS, "Entity {} killed", id);
+#define LOG_AT(level, category, ...) \
+    do { \
+        if (Logger::IsEnabled(level, category)) { \
+            Logger::Write(level, category, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(category, ...) LOG_AT(LogType::LOG_TRACE, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(category, ...) LOG_AT(LogType::LOG_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define LOG_INFO(category, ...) LOG_AT(LogType::LOG_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 3
+#define LOG_WARNING(category, ...) LOG_AT(LogType::LOG_WARNING, category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) ((void)0)
+#endif
+
+#define LOG_ERROR(category, ...) LOG_AT(LogType::LOG_ERROR, category, __VA_ARGS__)
+
+#endif
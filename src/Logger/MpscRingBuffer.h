@@ -0,0 +1,84 @@
+#ifndef MPSCRINGBUFFER_H
+#define MPSCRINGBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+///////////////////////////////////////////////////
+// MpscRingBuffer
+////////////////////////////////////////////////////
+// Bounded lock-free queue for many producer threads and a single consumer
+// thread. Each cell carries a sequence number telling whether it is free for
+// the producer at that position or ready for the consumer, so producers only
+// compete on one compare-exchange and never wait on each other.
+////////////////////////////////////////////////////
+template <typename T, std::size_t Capacity>
+class MpscRingBuffer {
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        std::array<Cell, Capacity> cells;
+        alignas(64) std::atomic<std::size_t> enqueuePos{0};
+        alignas(64) std::size_t dequeuePos = 0;
+
+    public:
+        MpscRingBuffer() {
+            for(std::size_t i = 0; i < Capacity; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // Any thread. Claims a cell and calls fill(T&) to write it in place,
+        // returns false without calling fill when the buffer is full
+        template <typename F>
+        bool TryPush(F&& fill) {
+            auto pos = enqueuePos.load(std::memory_order_relaxed);
+            while(true) {
+                Cell& cell = cells[pos & (Capacity - 1)];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+                if(diff == 0) {
+                    if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        fill(cell.value);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if(diff < 0) {
+                    return false;
+                } else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Consumer thread only. Calls consume(const T&) on the oldest element
+        // and frees its cell, returns false when nothing is ready
+        template <typename F>
+        bool TryPop(F&& consume) {
+            Cell& cell = cells[dequeuePos & (Capacity - 1)];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            if(static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(dequeuePos + 1) < 0) {
+                return false;
+            }
+
+            consume(static_cast<const T&>(cell.value));
+            cell.sequence.store(dequeuePos + Capacity, std::memory_order_release);
+            dequeuePos++;
+            return true;
+        }
+
+        // Number of elements claimed by producers so far
+        std::size_t GetPushedCount() const {
+            return enqueuePos.load(std::memory_order_acquire);
+        }
+};
+
+#endif
@@ -1,6 +1,17 @@
+#include <cstring>
 #include "Game/Game.h"
 
 int main(int argc, char* argv[]) {
+    // --binary-log <file> traces everything into a binary log, read it with logdecode
+    if (argc == 3 && std::strcmp(argv[1], "--binary-log") == 0) {
+        constexpr std::size_t binaryLogCapacity = 256 * 1024 * 1024;
+        if (Logger::OpenBinaryLog(argv[2], binaryLogCapacity)) {
+            Logger::SetLevel(LogType::LOG_TRACE);
+        } else {
+            Logger::Err("Cannot open the binary log " + std::string(argv[2]));
+        }
+    }
+
     Game game;
 
     game.Initialize();
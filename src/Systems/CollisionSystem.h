@@ -1,11 +1,34 @@
 #ifndef COLLISIONSYSTEM_H
 #define COLLISIONSYSTEM_H
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
 #include "../ECS/ECS.h"
 #include "../Components/BoxColliderComponent.h"
 #include "../Components/TransformComponent.h"
+#include "../Collision/Aabb.h"
+#include "../Collision/Broadphase.h"
+#include "../Collision/OverlapKernel.h"
+#include "../Collision/SpatialHashBroadphase.h"
+#include "../Collision/SweepAndPruneBroadphase.h"
+#include "../Collision/AabbTreeBroadphase.h"
 #include "../EventBus/EventBus.h"
-#include "../Events/CollisionEvent.h"
+#include "../Events/CollisionEnterEvent.h"
+#include "../Events/CollisionStayEvent.h"
+#include "../Events/CollisionExitEvent.h"
+
+// SPATIAL_HASH suits most scenes, SWEEP_AND_PRUNE pays off with many slowly moving colliders
+// and AABB_TREE with colliders of very different sizes, it also speeds up region and ray queries
+enum class BroadphaseType
+{
+    BRUTE_FORCE,
+    SPATIAL_HASH,
+    SWEEP_AND_PRUNE,
+    AABB_TREE
+};
 
 class CollisionSystem : public System
 {
@@ -14,56 +37,207 @@ public:
     {
         RequireComponent<TransformComponent>();
         RequireComponent<BoxColliderComponent>();
+        SetBroadphase(BroadphaseType::SPATIAL_HASH);
     }
 
+    void SetBroadphase(BroadphaseType type)
+    {
+        broadphaseType = type;
+        aabbTree = nullptr;
+        switch (type)
+        {
+        case BroadphaseType::BRUTE_FORCE:
+            broadphase = std::make_unique<BruteForceBroadphase>();
+            break;
+        case BroadphaseType::SPATIAL_HASH:
+            broadphase = std::make_unique<SpatialHashBroadphase>();
+            break;
+        case BroadphaseType::SWEEP_AND_PRUNE:
+            broadphase = std::make_unique<SweepAndPruneBroadphase>();
+            break;
+        case BroadphaseType::AABB_TREE:
+        {
+            auto tree = std::make_unique<AabbTreeBroadphase>();
+            aabbTree = tree.get();
+            broadphase = std::move(tree);
+            break;
+        }
+        }
+        broadphase->SetJobSystem(jobSystem);
+    }
+
+    // Lets the broadphase split its search across the threads of the job system,
+    // which has to outlive the system. Null brings it back to the calling thread
+    void SetJobSystem(JobSystem *jobSystem)
+    {
+        this->jobSystem = jobSystem;
+        broadphase->SetJobSystem(jobSystem);
+    }
+
+    BroadphaseType GetBroadphase() const
+    {
+        return broadphaseType;
+    }
+
+    // Queues a CollisionEnterEvent for the colliders starting to overlap, a CollisionStayEvent
+    // for the ones still overlapping since the last Update and a CollisionExitEvent for the
+    // ones that stopped, so one-shot reactions only listen to the enter events. Event types
+    // nobody subscribed to are not queued. A contact whose entity was killed and its id given
+    // to another entity ends without an exit event, the id no longer names that entity
     void Update(EventBus &eventBus)
     {
-        auto &entities = GetSystemEntities();
-        for (auto it = entities.begin(); it != entities.end(); ++it)
+        // AABB (axis-aligned bounding boxes) of every collider, computed once per frame
+        colliderEntities = GetSystemEntities();
+        colliders.Clear();
+        for (const auto &entity : colliderEntities)
+        {
+            const auto &transform = entity.GetComponent<TransformComponent>();
+            const auto &collider = entity.GetComponent<BoxColliderComponent>();
+            colliders.Add(entity.GetId(), ComputeAabb(transform, collider), CollisionFilter{collider.layer, collider.mask});
+        }
+
+        pairs.clear();
+        broadphase->FindPairs(colliders, pairs);
+
+        // The order of the pairs depends on the broadphase and on how the threads shared
+        // the work, sorting them by entity ids makes the events come out the same every run
+        contacts.clear();
+        for (const auto &[a, b] : pairs)
+        {
+            const auto idA = colliders.entityIds[a];
+            const auto idB = colliders.entityIds[b];
+            const auto &entityA = colliderEntities[a];
+            const auto &entityB = colliderEntities[b];
+            contacts.push_back(idA < idB ? Contact{idA, idB, entityA.GetGeneration(), entityB.GetGeneration(), entityA, entityB}
+                                         : Contact{idB, idA, entityB.GetGeneration(), entityA.GetGeneration(), entityB, entityA});
+        }
+        std::sort(contacts.begin(), contacts.end(), contactLess);
+
+        const bool isEnterHeard = eventBus.HasSubscribers<CollisionEnterEvent>();
+        const bool isStayHeard = eventBus.HasSubscribers<CollisionStayEvent>();
+        const bool isExitHeard = eventBus.HasSubscribers<CollisionExitEvent>();
+
+        // Both frames' contacts are sorted, one merge tells the new, kept and gone ones apart.
+        // The generations are part of the order, so a reused id makes a new contact
+        auto previous = previousContacts.begin();
+        auto current = contacts.begin();
+        while (previous != previousContacts.end() || current != contacts.end())
         {
-            auto entityA = *it;
-            for (auto loopIt = it; loopIt != entities.end(); ++loopIt)
+            if (previous == previousContacts.end() || (current != contacts.end() && contactLess(*current, *previous)))
+            {
+                if (isEnterHeard)
+                {
+                    eventBus.Enqueue<CollisionEnterEvent>(current->low, current->high);
+                }
+                current++;
+            }
+            else if (current == contacts.end() || contactLess(*previous, *current))
+            {
+                if (isExitHeard && !isReused(previous->low, previous->lowGeneration) && !isReused(previous->high, previous->highGeneration))
+                {
+                    eventBus.Enqueue<CollisionExitEvent>(previous->low, previous->high);
+                }
+                previous++;
+            }
+            else
             {
-                if (it == loopIt)
-                    continue;
-                auto entityB = *loopIt;
-                if (entityA != entityB &&
-                    entityA.HasComponent<BoxColliderComponent>() &&
-                    entityB.HasComponent<BoxColliderComponent>() &&
-                    isCollision(entityA, entityB))
+                if (isStayHeard)
                 {
-                    eventBus.EmitEvent<CollisionEvent>(entityA, entityB);
+                    eventBus.Enqueue<CollisionStayEvent>(current->low, current->high);
                 }
+                previous++;
+                current++;
             }
         }
+        previousContacts.swap(contacts);
     }
 
-private:
-    // AABB (axis-aligned bounding boxes) collision detection
-    bool isCollision(const Entity &entA, const Entity &entB)
+    // Entities whose collider overlapped the region at the last Update
+    void QueryRegion(const Aabb &region, std::vector<Entity> &result)
     {
-        const auto &tComponentA = entA.GetComponent<TransformComponent>();
-        const auto &tComponentB = entB.GetComponent<TransformComponent>();
-        const auto &colliderComponentA = entA.GetComponent<BoxColliderComponent>();
-        const auto &colliderComponentB = entB.GetComponent<BoxColliderComponent>();
+        queryIndices.clear();
+        if (aabbTree)
+        {
+            aabbTree->QueryRegion(region, queryIndices);
+        }
+        else
+        {
+            const auto colliderCount = static_cast<std::uint32_t>(colliders.GetSize());
+            ForEachOverlap(region, colliders, 0, colliderCount, [&](std::uint32_t i)
+                           { queryIndices.push_back(i); });
+        }
+        appendQueryResult(result);
+    }
 
-        const auto entAXmin = tComponentA.position.x + colliderComponentA.offset.x;
-        const auto entAXmax = entAXmin + colliderComponentA.width * tComponentA.scale.x;
+    // Entities whose collider the segment from start to end crossed at the last Update
+    void QueryRay(const glm::vec2 &start, const glm::vec2 &end, std::vector<Entity> &result)
+    {
+        queryIndices.clear();
+        if (aabbTree)
+        {
+            aabbTree->QueryRay(start, end, queryIndices);
+        }
+        else
+        {
+            for (std::uint32_t i = 0; i < colliders.GetSize(); i++)
+            {
+                if (colliders.GetAabb(i).IntersectsSegment(start, end))
+                {
+                    queryIndices.push_back(i);
+                }
+            }
+        }
+        appendQueryResult(result);
+    }
 
-        const auto entAYmin = tComponentA.position.y + colliderComponentA.offset.y;
-        const auto entAYmax = entAYmin + colliderComponentA.height * tComponentA.scale.y;
+private:
+    BroadphaseType broadphaseType;
+    std::unique_ptr<IBroadphase> broadphase;
+    JobSystem *jobSystem = nullptr;
+    // Set when the broadphase is an AABB tree, the queries then go through it
+    AabbTreeBroadphase *aabbTree = nullptr;
+
+    // Reused from frame to frame, colliders[i] belongs to colliderEntities[i]
+    std::vector<Entity> colliderEntities;
+    ColliderBounds colliders;
+    std::vector<ColliderPair> pairs;
+    // Two overlapping colliders, the lowest entity id first, with the generations
+    // their entities had so a contact outliving one of them is told apart
+    struct Contact
+    {
+        std::size_t lowId;
+        std::size_t highId;
+        std::uint64_t lowGeneration;
+        std::uint64_t highGeneration;
+        Entity low;
+        Entity high;
+    };
+    std::vector<Contact> contacts;
+    // The contacts of the last Update, sorted, to tell which ones start, go on or end
+    std::vector<Contact> previousContacts;
+    std::vector<std::uint32_t> queryIndices;
 
-        const auto entBXmin = tComponentB.position.x + colliderComponentB.offset.x;
-        const auto entBXmax = entBXmin + colliderComponentA.width * tComponentB.scale.x;
+    static bool contactLess(const Contact &lhs, const Contact &rhs)
+    {
+        return std::tie(lhs.lowId, lhs.highId, lhs.lowGeneration, lhs.highGeneration) <
+               std::tie(rhs.lowId, rhs.highId, rhs.lowGeneration, rhs.highGeneration);
+    }
 
-        const auto entBYmin = tComponentB.position.y + colliderComponentB.offset.y;
-        const auto entBYmax = entBXmin + colliderComponentB.height * tComponentB.scale.y;
+    // Whether the id of the entity, which had the given generation, now holds another entity.
+    // A killed entity whose id is still free keeps its exit event
+    static bool isReused(const Entity &entity, std::uint64_t generation)
+    {
+        const auto currentGeneration = entity.GetGeneration();
+        return currentGeneration != 0 && currentGeneration != generation;
+    }
 
-        return entAXmin <= entBXmax &&
-               entAXmax >= entBXmin &&
-               entAYmin <= entBYmax &&
-               entAYmax >= entBYmin;
+    void appendQueryResult(std::vector<Entity> &result)
+    {
+        for (const auto index : queryIndices)
+        {
+            result.push_back(colliderEntities[index]);
+        }
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -4,10 +4,13 @@
 #include "../ECS/ECS.h"
 #include "../Components/BoxColliderComponent.h"
 #include "../EventBus/EventBus.h"
-#include "../Events/CollisionEvent.h"
+#include "../Events/CollisionEnterEvent.h"
 
 class DamageSystem : public System
 {
+private:
+    SubscriptionHandle collisionSubscription;
+
 public:
     DamageSystem()
     {
@@ -16,15 +19,19 @@ public:
 
     void SubscribeToEvents(EventBus &eventBus)
     {
-        eventBus.SubscribeToEvent<DamageSystem, CollisionEvent>(*this, &DamageSystem::onCollision);
+        collisionSubscription = eventBus.SubscribeToEvent<&DamageSystem::onCollisions>(*this);
     }
 
-    void onCollision(CollisionEvent &event)
+    // Receives every collision starting this frame at once when the event bus dispatches them
+    void onCollisions(EventSpan<CollisionEnterEvent> events)
     {
-        Logger::Log("The Damage system received an event collisions between entities " +
-                    std::to_string(event.a.GetId()) + " and " + std::to_string(event.b.GetId()));
-        event.a.Kill();
-        event.b.Kill();
+        LOG_DEBUG(LogCategory::GAME, "The Damage system received {} collision events", events.size());
+        for (auto &event : events)
+        {
+            LOG_TRACE(LogCategory::GAME, "Collision between entities {} and {}", event.a.GetId(), event.b.GetId());
+            event.a.Kill();
+            event.b.Kill();
+        }
     }
 
     void Update()
@@ -7,17 +7,18 @@
 
 class KeyBoardMovementSystem : public System
 {
+private:
+    SubscriptionHandle keyPressedSubscription;
+
 public:
     void SubscribeToEvents(EventBus &eventBus)
     {
-        eventBus.SubscribeToEvent<KeyBoardMovementSystem, KeyPressedEvent>(*this, &KeyBoardMovementSystem::onKeyPressed);
+        keyPressedSubscription = eventBus.SubscribeToEvent<&KeyBoardMovementSystem::onKeyPressed>(*this);
     }
 
     void onKeyPressed(KeyPressedEvent &event)
     {
-        std::string keyCode = std::to_string(event.keyPressed);
-        std::string keySymbol = std::string(1, event.keyPressed);
-        Logger::Log("Key pressed event emitted: [" + keyCode + "]" + keySymbol);
+        LOG_DEBUG(LogCategory::GAME, "Key pressed event emitted: [{}]{}", event.keyPressed, std::string(1, event.keyPressed));
     }
 
     void Update()
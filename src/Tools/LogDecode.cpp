@@ -0,0 +1,53 @@
+// logdecode: prints a binary log written by BinaryLogSink as text.
+// Usage: ./logdecode <binary log file>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../Logger/BinaryLogDecoder.h"
+
+const char* levelName(std::uint8_t level) {
+    static const char* names[] = {"TRC", "DBG", "LOG", "WRN", "ERR"};
+    return level < 5 ? names[level] : "???";
+}
+
+int main(int argc, char* argv[]) {
+    if(argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <binary log file>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if(!file) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    const std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    // Definitions may come after the messages using them, print once all are read
+    DecodedLog log;
+    switch (DecodeBinaryLog(data, log))
+    {
+    case BinaryLogDecodeResult::NOT_A_LOG:
+        std::cerr << argv[1] << " is not a binary log" << std::endl;
+        return 1;
+    case BinaryLogDecodeResult::UNSUPPORTED_VERSION:
+        std::cerr << "Unsupported binary log version " << log.version << std::endl;
+        return 1;
+    case BinaryLogDecodeResult::OK:
+        break;
+    }
+
+    for(const auto& message: log.messages) {
+        std::cout << levelName(message.level) << " [ " << LogClock::Format(message.time, log.anchor) << " ] - " << FormatLogMessage(log, message) << '\n';
+    }
+
+    if(!log.isComplete) {
+        std::cerr << "Binary log ends with a corrupted or partial record" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "../ECS/ECS.h"
+#include "../EventBus/EventBus.h"
+#include "../Jobs/JobSystem.h"
+#include "../Systems/CollisionSystem.h"
+
+// Time per frame of CollisionSystem::Update for every broadphase, on scenes of
+// small moving colliders with a few large ones, at a constant density. The
+// broadphases able to split their search also run on the job system. The
+// layered scenes are half bullets and 40% tiles, which do not collide among themselves
+struct BroadphaseCase {
+    BroadphaseType type;
+    std::string name;
+    bool isParallel;
+};
+
+struct BenchResult {
+    double millisecondsPerFrame;
+    std::size_t pairsPerFrame;
+};
+
+void dispatchCollisionEvents(EventBus& eventBus) {
+    eventBus.Dispatch<CollisionEnterEvent>();
+    eventBus.Dispatch<CollisionStayEvent>();
+    eventBus.Dispatch<CollisionExitEvent>();
+}
+
+BenchResult runCollisionBench(BroadphaseType type, JobSystem* jobSystem, std::size_t colliderCount, int frameCount, bool isLayered) {
+    constexpr std::uint32_t BULLET = 1u << 1;
+    constexpr std::uint32_t TILE = 1u << 2;
+    constexpr std::uint32_t ENEMY = 1u << 3;
+
+    Registry registry;
+    registry.AddSystem<CollisionSystem>();
+    auto& collisionSystem = registry.GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(type);
+    collisionSystem.SetJobSystem(jobSystem);
+    EventBus eventBus;
+
+    // Same scene for every broadphase
+    std::mt19937 random{42};
+    const float worldSize = std::sqrt(static_cast<float>(colliderCount)) * 48.0f;
+    std::uniform_real_distribution<float> position{0.0f, worldSize};
+    std::uniform_real_distribution<float> velocity{-1.0f, 1.0f};
+    std::uniform_int_distribution<int> smallSize{8, 32};
+    std::uniform_int_distribution<int> largeSize{128, 256};
+    std::vector<Entity> entities;
+    std::vector<glm::vec2> velocities;
+    for(std::size_t i = 0; i < colliderCount; i++) {
+        Entity entity = registry.CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(position(random), position(random)));
+        const auto size = i % 100 == 0 ? largeSize(random) : smallSize(random);
+        if(!isLayered) {
+            entity.AddComponent<BoxColliderComponent>(size, size);
+        } else if(i % 10 < 5) {
+            entity.AddComponent<BoxColliderComponent>(size, size, glm::vec2(0), BULLET, TILE | ENEMY);
+        } else if(i % 10 < 9) {
+            entity.AddComponent<BoxColliderComponent>(size, size, glm::vec2(0), TILE, BULLET | ENEMY);
+        } else {
+            entity.AddComponent<BoxColliderComponent>(size, size, glm::vec2(0), ENEMY, BoxColliderComponent::ALL_LAYERS);
+        }
+        entities.push_back(entity);
+        velocities.emplace_back(velocity(random), velocity(random));
+    }
+    registry.Update();
+
+    // Warm up the buffers reused from frame to frame
+    collisionSystem.Update(eventBus);
+    dispatchCollisionEvents(eventBus);
+
+    std::size_t pairCount = 0;
+    std::chrono::steady_clock::duration elapsed{0};
+    for(int frame = 0; frame < frameCount; frame++) {
+        for(std::size_t i = 0; i < entities.size(); i++) {
+            entities[i].GetComponent<TransformComponent>().position += velocities[i];
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        collisionSystem.Update(eventBus);
+        elapsed += std::chrono::steady_clock::now() - start;
+
+        pairCount += eventBus.GetQueuedCount<CollisionEnterEvent>() + eventBus.GetQueuedCount<CollisionStayEvent>();
+        dispatchCollisionEvents(eventBus);
+    }
+
+    const auto milliseconds = std::chrono::duration<double, std::milli>(elapsed).count();
+    return {milliseconds / frameCount, pairCount / frameCount};
+}
+
+int main() {
+    Logger::SetLevel(LogType::LOG_WARNING);
+
+    const std::vector<BroadphaseCase> broadphases = {
+        {BroadphaseType::BRUTE_FORCE, "brute force", false},
+        {BroadphaseType::BRUTE_FORCE, "brute force/mt", true},
+        {BroadphaseType::SPATIAL_HASH, "spatial hash", false},
+        {BroadphaseType::SPATIAL_HASH, "spatial hash/mt", true},
+        {BroadphaseType::SWEEP_AND_PRUNE, "sweep & prune", false},
+        {BroadphaseType::AABB_TREE, "aabb tree", false}
+    };
+    JobSystem jobSystem;
+
+    std::printf("%zu threads\n", jobSystem.GetThreadCount());
+    for(const bool isLayered : {false, true}) {
+        std::printf("\n%s\n", isLayered ? "bullets, tiles and enemies on layers" : "every collider on every layer");
+        std::printf("%10s  %-16s %12s %10s\n", "colliders", "broadphase", "ms/frame", "pairs");
+        for(const std::size_t colliderCount : {1000, 10000, 50000}) {
+            const int frameCount = colliderCount >= 50000 ? 3 : colliderCount >= 10000 ? 10 : 50;
+            for(const auto& broadphase : broadphases) {
+                const auto result = runCollisionBench(broadphase.type, broadphase.isParallel ? &jobSystem : nullptr, colliderCount, frameCount, isLayered);
+                std::printf("%10zu  %-16s %12.3f %10zu\n", colliderCount, broadphase.name.c_str(), result.millisecondsPerFrame, result.pairsPerFrame);
+            }
+        }
+    }
+
+    Logger::Flush();
+    return 0;
+}
@@ -0,0 +1,416 @@
+#include "collision.test.h"
+#include "../Collision/SpatialHashBroadphase.h"
+#include "../Collision/SweepAndPruneBroadphase.h"
+#include "../Collision/AabbTreeBroadphase.h"
+#include "../Collision/OverlapKernel.h"
+#include "../Systems/CollisionSystem.h"
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+// Random small colliders plus a few large ones spanning many cells
+ColliderBounds makeTestColliders(std::size_t count) {
+    std::mt19937 random{7};
+    std::uniform_real_distribution<float> position{0.0f, 2000.0f};
+    std::uniform_real_distribution<float> smallSize{4.0f, 40.0f};
+    std::uniform_real_distribution<float> largeSize{300.0f, 900.0f};
+
+    ColliderBounds colliders;
+    for (std::size_t i = 0; i < count; i++) {
+        const auto x = position(random);
+        const auto y = position(random);
+        const auto size = i % 50 == 0 ? largeSize(random) : smallSize(random);
+        colliders.Add(i, Aabb{x, y, x + size, y + size});
+    }
+    return colliders;
+}
+
+ColliderBounds makeColliders(const std::vector<Aabb>& boxes) {
+    ColliderBounds colliders;
+    for (std::size_t i = 0; i < boxes.size(); i++) {
+        colliders.Add(i, boxes[i]);
+    }
+    return colliders;
+}
+
+// Moves every collider, drops one and brings one back under a new entity id
+void stepTestColliders(ColliderBounds& colliders, std::mt19937& random, float maxStep, int frame) {
+    std::uniform_real_distribution<float> step{-maxStep, maxStep};
+    for (std::size_t i = 0; i < colliders.GetSize(); i++) {
+        const auto dx = step(random);
+        const auto dy = step(random);
+        const auto bounds = colliders.GetAabb(i);
+        colliders.SetAabb(i, Aabb{bounds.minX + dx, bounds.minY + dy, bounds.maxX + dx, bounds.maxY + dy});
+    }
+    colliders.SwapRemove(frame * 7);
+    colliders.Add(1000 + static_cast<std::size_t>(frame), colliders.GetAabb(frame));
+}
+
+std::vector<ColliderPair> findSortedPairs(IBroadphase& broadphase, const ColliderBounds& colliders) {
+    std::vector<ColliderPair> pairs;
+    broadphase.FindPairs(colliders, pairs);
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+void testSpatialHashBroadphase() {
+    const auto colliders = makeTestColliders(1000);
+    BruteForceBroadphase bruteForce;
+    SpatialHashBroadphase spatialHash;
+
+    const auto expected = findSortedPairs(bruteForce, colliders);
+    const auto pairs = findSortedPairs(spatialHash, colliders);
+    assert((!expected.empty()) && "The test scene should have overlapping colliders");
+    assert((pairs == expected) && "The spatial hash should find every overlapping pair exactly once");
+    assert((spatialHash.GetCellSize() < 300.0f) && "The cell size should follow the small colliders, not the few large ones");
+
+    // Touching edges count as overlapping, like in the brute force test
+    const auto touching = makeColliders({
+        Aabb{0.0f, 0.0f, 10.0f, 10.0f},
+        Aabb{10.0f, 10.0f, 20.0f, 20.0f},
+        Aabb{21.0f, 0.0f, 30.0f, 10.0f}
+    });
+    assert((findSortedPairs(spatialHash, touching) == std::vector<ColliderPair>{{0, 1}}) && "Colliders sharing an edge should be reported");
+
+    // Cells past the int32 range are clamped, so far away colliders only share the edge cells
+    const auto farAway = makeColliders({
+        Aabb{1e30f, 1e30f, 1.1e30f, 1.1e30f},
+        Aabb{1.05e30f, 1.05e30f, 1.2e30f, 1.2e30f},
+        Aabb{2e30f, 2e30f, 2.1e30f, 2.1e30f},
+        Aabb{-1e30f, -1e30f, 1e30f, 1e30f},
+        Aabb{0.0f, 0.0f, 1.0f, 1.0f}
+    });
+    assert((findSortedPairs(spatialHash, farAway) == findSortedPairs(bruteForce, farAway)) && "Colliders out of the cell range should still be paired");
+}
+
+void testSweepAndPruneBroadphase() {
+    auto colliders = makeTestColliders(1000);
+    BruteForceBroadphase bruteForce;
+    SweepAndPruneBroadphase sweepAndPrune;
+
+    // The sorted endpoints persist, so follow the colliders over frames where
+    // they move, leave and come back under new entity ids
+    std::mt19937 random{11};
+    for (int frame = 0; frame < 10; frame++) {
+        assert((findSortedPairs(sweepAndPrune, colliders) == findSortedPairs(bruteForce, colliders)) && "Sweep and prune should find every overlapping pair exactly once");
+        stepTestColliders(colliders, random, 3.0f, frame);
+    }
+}
+
+void testAabbTreeBroadphase() {
+    auto colliders = makeTestColliders(1000);
+    BruteForceBroadphase bruteForce;
+    AabbTreeBroadphase aabbTree;
+
+    std::mt19937 random{13};
+    for (int frame = 0; frame < 10; frame++) {
+        assert((findSortedPairs(aabbTree, colliders) == findSortedPairs(bruteForce, colliders)) && "The AABB tree should find every overlapping pair exactly once");
+        const auto& tree = aabbTree.GetTree();
+        assert((tree.Validate() && tree.GetProxyCount() == colliders.GetSize()) && "The tree should hold one valid proxy per collider");
+        assert((tree.GetHeight() <= 2 * std::log2(colliders.GetSize()) + 2) && "Rotations should keep the tree balanced");
+        stepTestColliders(colliders, random, 6.0f, frame);
+    }
+
+    // Region and ray queries only report the colliders they actually touch
+    const auto scene = makeColliders({
+        Aabb{0.0f, 0.0f, 10.0f, 10.0f},
+        Aabb{100.0f, 0.0f, 110.0f, 10.0f},
+        Aabb{0.0f, 100.0f, 500.0f, 600.0f},
+        Aabb{12.0f, 12.0f, 13.0f, 13.0f}
+    });
+    AabbTreeBroadphase queries;
+    std::vector<ColliderPair> pairs;
+    queries.FindPairs(scene, pairs);
+
+    std::vector<std::uint32_t> found;
+    queries.QueryRegion(Aabb{5.0f, 5.0f, 11.0f, 11.0f}, found);
+    assert((found == std::vector<std::uint32_t>{0}) && "A region query should skip colliders only within the fat bounds");
+
+    found.clear();
+    queries.QueryRay(glm::vec2(-10.0f, 5.0f), glm::vec2(200.0f, 5.0f), found);
+    std::sort(found.begin(), found.end());
+    assert((found == std::vector<std::uint32_t>{0, 1}) && "A ray query should report the colliders along the segment");
+
+    found.clear();
+    queries.QueryRay(glm::vec2(50.0f, 50.0f), glm::vec2(50.0f, 99.0f), found);
+    assert((found.empty()) && "A ray stopping short of a collider should not report it");
+}
+
+void testOverlapKernel() {
+    const auto colliders = makeTestColliders(203);
+    const auto box = Aabb{400.0f, 400.0f, 900.0f, 700.0f};
+
+    // Ranges starting and ending off the batch boundaries go through both the batches and the remainder
+    for (std::uint32_t first : {0u, 3u, 8u, 13u}) {
+        for (std::uint32_t last : {first, first + 5, 160u, 203u}) {
+            std::vector<std::uint32_t> expected;
+            for (auto i = first; i < last; i++) {
+                if (box.Overlaps(colliders.GetAabb(i))) {
+                    expected.push_back(i);
+                }
+            }
+            std::vector<std::uint32_t> found;
+            ForEachOverlap(box, colliders, first, last, [&](std::uint32_t i) { found.push_back(i); });
+            assert((found == expected) && "The overlap kernel should report the same colliders as Aabb::Overlaps, in index order");
+        }
+    }
+
+    const auto touching = makeColliders(std::vector<Aabb>(9, Aabb{10.0f, 10.0f, 20.0f, 20.0f}));
+    std::uint32_t touchCount = 0;
+    ForEachOverlap(Aabb{0.0f, 0.0f, 10.0f, 10.0f}, touching, 0, 9, [&](std::uint32_t) { touchCount++; });
+    assert((touchCount == 9) && "Touching boxes should overlap in the batches as in the remainder");
+}
+
+void testParallelBroadphase() {
+    const auto colliders = makeTestColliders(3000);
+    JobSystem jobSystem{3};
+
+    BruteForceBroadphase bruteForce;
+    const auto expected = findSortedPairs(bruteForce, colliders);
+    bruteForce.SetJobSystem(&jobSystem);
+    assert((findSortedPairs(bruteForce, colliders) == expected) && "Splitting the brute force across threads should find the same pairs");
+
+    SpatialHashBroadphase spatialHash;
+    spatialHash.SetJobSystem(&jobSystem);
+    assert((findSortedPairs(spatialHash, colliders) == expected) && "Splitting the spatial hash across threads should find the same pairs");
+}
+
+using EntityIdPairs = std::vector<std::pair<std::size_t, std::size_t>>;
+
+class CollisionRecorder {
+    public:
+        EntityIdPairs entered;
+        EntityIdPairs stayed;
+        EntityIdPairs exited;
+        std::vector<SubscriptionHandle> subscriptions;
+
+        void SubscribeToEvents(EventBus& eventBus) {
+            subscriptions.push_back(eventBus.SubscribeToEvent<&CollisionRecorder::onEnter>(*this));
+            subscriptions.push_back(eventBus.SubscribeToEvent<&CollisionRecorder::onStay>(*this));
+            subscriptions.push_back(eventBus.SubscribeToEvent<&CollisionRecorder::onExit>(*this));
+        }
+
+        void Clear() {
+            entered.clear();
+            stayed.clear();
+            exited.clear();
+        }
+
+        void onEnter(EventSpan<CollisionEnterEvent> events) {
+            record(events, entered);
+        }
+
+        void onStay(EventSpan<CollisionStayEvent> events) {
+            record(events, stayed);
+        }
+
+        void onExit(EventSpan<CollisionExitEvent> events) {
+            record(events, exited);
+        }
+
+    private:
+        template <typename TEvent>
+        void record(EventSpan<TEvent> events, EntityIdPairs& pairs) {
+            for (const auto& event : events) {
+                pairs.emplace_back(event.a.GetId(), event.b.GetId());
+            }
+        }
+};
+
+void updateCollisions(CollisionSystem& collisionSystem, EventBus& eventBus) {
+    collisionSystem.Update(eventBus);
+    eventBus.Dispatch<CollisionEnterEvent>();
+    eventBus.Dispatch<CollisionStayEvent>();
+    eventBus.Dispatch<CollisionExitEvent>();
+}
+
+// Records the collisions starting on the first frame over the test colliders
+EntityIdPairs recordCollisions(BroadphaseType type, JobSystem* jobSystem) {
+    Registry registry;
+    registry.AddSystem<CollisionSystem>();
+    auto& collisionSystem = registry.GetSystem<CollisionSystem>();
+    collisionSystem.SetBroadphase(type);
+    collisionSystem.SetJobSystem(jobSystem);
+
+    const auto colliders = makeTestColliders(1000);
+    for (std::size_t i = 0; i < colliders.GetSize(); i++) {
+        const auto bounds = colliders.GetAabb(i);
+        Entity entity = registry.CreateEntity();
+        entity.AddComponent<TransformComponent>(glm::vec2(bounds.minX, bounds.minY));
+        entity.AddComponent<BoxColliderComponent>(static_cast<int>(bounds.maxX - bounds.minX), static_cast<int>(bounds.maxY - bounds.minY));
+    }
+    registry.Update();
+
+    EventBus eventBus;
+    CollisionRecorder recorder;
+    recorder.SubscribeToEvents(eventBus);
+    updateCollisions(collisionSystem, eventBus);
+    return recorder.entered;
+}
+
+void testCollisionEventOrder() {
+    JobSystem jobSystem{3};
+    const auto expected = recordCollisions(BroadphaseType::BRUTE_FORCE, nullptr);
+    assert((!expected.empty() && std::is_sorted(expected.begin(), expected.end())) && "Collision events should come out sorted by entity ids");
+    assert((recordCollisions(BroadphaseType::SPATIAL_HASH, &jobSystem) == expected) && "The events should not depend on how the threads shared the work");
+    assert((recordCollisions(BroadphaseType::BRUTE_FORCE, &jobSystem) == expected) && "The events should not depend on how the threads shared the work");
+    assert((recordCollisions(BroadphaseType::AABB_TREE, nullptr) == expected) && "The events should not depend on the broadphase");
+}
+
+void testCollisionContactEvents() {
+    Registry registry;
+    registry.AddSystem<CollisionSystem>();
+    auto& collisionSystem = registry.GetSystem<CollisionSystem>();
+    Entity tank = registry.CreateEntity();
+    tank.AddComponent<TransformComponent>(glm::vec2(0.0f, 0.0f));
+    tank.AddComponent<BoxColliderComponent>(32, 32);
+    Entity truck = registry.CreateEntity();
+    truck.AddComponent<TransformComponent>(glm::vec2(16.0f, 16.0f));
+    truck.AddComponent<BoxColliderComponent>(32, 32);
+    Entity chopper = registry.CreateEntity();
+    chopper.AddComponent<TransformComponent>(glm::vec2(500.0f, 0.0f));
+    chopper.AddComponent<BoxColliderComponent>(32, 32);
+    registry.Update();
+
+    EventBus eventBus;
+    CollisionRecorder recorder;
+    recorder.SubscribeToEvents(eventBus);
+    const EntityIdPairs tankTruck = {{tank.GetId(), truck.GetId()}};
+    const EntityIdPairs truckChopper = {{truck.GetId(), chopper.GetId()}};
+
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered == tankTruck && recorder.stayed.empty() && recorder.exited.empty()) && "A new overlap should only send an enter event");
+
+    recorder.Clear();
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered.empty() && recorder.stayed == tankTruck && recorder.exited.empty()) && "An ongoing overlap should only send stay events");
+
+    // The truck leaves the tank for the chopper
+    recorder.Clear();
+    truck.GetComponent<TransformComponent>().position = glm::vec2(490.0f, 10.0f);
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered == truckChopper && recorder.stayed.empty() && recorder.exited == tankTruck) && "Moving apart should send an exit event and the new overlap an enter event");
+
+    // A killed entity ends its contacts
+    recorder.Clear();
+    chopper.Kill();
+    registry.Update();
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered.empty() && recorder.stayed.empty() && recorder.exited == truckChopper) && "Removing a collider should send an exit event for its contacts");
+
+    recorder.Clear();
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered.empty() && recorder.stayed.empty() && recorder.exited.empty()) && "Without contacts no event should be sent");
+}
+
+void testCollisionContactsOfReusedIds() {
+    Registry registry;
+    registry.AddSystem<CollisionSystem>();
+    auto& collisionSystem = registry.GetSystem<CollisionSystem>();
+    Entity tank = registry.CreateEntity();
+    tank.AddComponent<TransformComponent>(glm::vec2(0.0f, 0.0f));
+    tank.AddComponent<BoxColliderComponent>(32, 32);
+    Entity truck = registry.CreateEntity();
+    truck.AddComponent<TransformComponent>(glm::vec2(16.0f, 16.0f));
+    truck.AddComponent<BoxColliderComponent>(32, 32);
+    registry.Update();
+
+    EventBus eventBus;
+    CollisionRecorder recorder;
+    recorder.SubscribeToEvents(eventBus);
+    const EntityIdPairs tankTruck = {{tank.GetId(), truck.GetId()}};
+    updateCollisions(collisionSystem, eventBus);
+
+    // The truck dies and a jeep takes its id, at the same place
+    recorder.Clear();
+    truck.Kill();
+    registry.Update();
+    Entity jeep = registry.CreateEntity();
+    jeep.AddComponent<TransformComponent>(glm::vec2(16.0f, 16.0f));
+    jeep.AddComponent<BoxColliderComponent>(32, 32);
+    registry.Update();
+    assert((jeep.GetId() == truck.GetId()) && "The killed entity id should be reused");
+    updateCollisions(collisionSystem, eventBus);
+    assert((recorder.entered == tankTruck && recorder.stayed.empty() && recorder.exited.empty()) && "An entity reusing an id should start a new contact, without an exit for the old one");
+
+    // Nobody listens to the stay events any more, they are not queued, even
+    // with targeted subscribers on another collision event type
+    recorder.Clear();
+    recorder.subscriptions[1].Unsubscribe();
+    recorder.subscriptions.push_back(eventBus.SubscribeToEvent<&CollisionRecorder::onExit>(recorder, tank));
+    collisionSystem.Update(eventBus);
+    assert((eventBus.GetQueuedCount<CollisionStayEvent>() == 0) && "Events without subscribers should not be queued");
+}
+
+void testCollisionLayers() {
+    constexpr std::uint32_t BULLET = 1u << 1;
+    constexpr std::uint32_t TILE = 1u << 2;
+    constexpr std::uint32_t ENEMY = 1u << 3;
+    const CollisionFilter kinds[] = {
+        {BULLET, TILE | ENEMY},
+        {TILE, BULLET | ENEMY},
+        {ENEMY, BoxColliderComponent::ALL_LAYERS}
+    };
+
+    const auto unfiltered = makeTestColliders(1000);
+    ColliderBounds colliders;
+    for (std::size_t i = 0; i < unfiltered.GetSize(); i++) {
+        colliders.Add(i, unfiltered.GetAabb(i), kinds[i % 3]);
+    }
+
+    std::vector<ColliderPair> expected;
+    for (std::uint32_t i = 0; i < colliders.GetSize(); i++) {
+        for (std::uint32_t j = i + 1; j < colliders.GetSize(); j++) {
+            if (colliders.CanCollide(i, j) && colliders.GetAabb(i).Overlaps(colliders.GetAabb(j))) {
+                expected.emplace_back(i, j);
+            }
+        }
+    }
+    BruteForceBroadphase bruteForce;
+    assert((!expected.empty() && expected.size() < findSortedPairs(bruteForce, unfiltered).size()) && "The layers should rule out some of the overlapping pairs");
+
+    SpatialHashBroadphase spatialHash;
+    SweepAndPruneBroadphase sweepAndPrune;
+    AabbTreeBroadphase aabbTree;
+    assert((findSortedPairs(bruteForce, colliders) == expected) && "The brute force should skip the pairs the layers rule out");
+    assert((findSortedPairs(spatialHash, colliders) == expected) && "The spatial hash should skip the pairs the layers rule out");
+    assert((findSortedPairs(sweepAndPrune, colliders) == expected) && "Sweep and prune should skip the pairs the layers rule out");
+    assert((findSortedPairs(aabbTree, colliders) == expected) && "The AABB tree should skip the pairs the layers rule out");
+
+    // The kernel's filtered batches against the scalar rule
+    const auto box = Aabb{400.0f, 400.0f, 900.0f, 700.0f};
+    for (const auto& filter : kinds) {
+        std::vector<std::uint32_t> expectedIndices;
+        for (std::uint32_t i = 3; i < colliders.GetSize(); i++) {
+            if (filter.Accepts(colliders.GetFilter(i)) && box.Overlaps(colliders.GetAabb(i))) {
+                expectedIndices.push_back(i);
+            }
+        }
+        std::vector<std::uint32_t> found;
+        ForEachOverlap(box, filter, colliders, 3, static_cast<std::uint32_t>(colliders.GetSize()), [&](std::uint32_t i) { found.push_back(i); });
+        assert((found == expectedIndices) && "The overlap kernel should skip the colliders the filter rules out");
+    }
+
+    // Two bullets on top of each other never collide, a bullet and a tile do
+    Registry registry;
+    registry.AddSystem<CollisionSystem>();
+    auto& collisionSystem = registry.GetSystem<CollisionSystem>();
+    Entity bullet = registry.CreateEntity();
+    bullet.AddComponent<TransformComponent>(glm::vec2(0.0f, 0.0f));
+    bullet.AddComponent<BoxColliderComponent>(4, 4, glm::vec2(0), BULLET, TILE | ENEMY);
+    Entity otherBullet = registry.CreateEntity();
+    otherBullet.AddComponent<TransformComponent>(glm::vec2(1.0f, 1.0f));
+    otherBullet.AddComponent<BoxColliderComponent>(4, 4, glm::vec2(0), BULLET, TILE | ENEMY);
+    Entity tile = registry.CreateEntity();
+    tile.AddComponent<TransformComponent>(glm::vec2(2.0f, 2.0f));
+    tile.AddComponent<BoxColliderComponent>(32, 32, glm::vec2(0), TILE, BULLET | ENEMY);
+    registry.Update();
+
+    EventBus eventBus;
+    CollisionRecorder recorder;
+    recorder.SubscribeToEvents(eventBus);
+    updateCollisions(collisionSystem, eventBus);
+    const EntityIdPairs bulletsOnTile = {{bullet.GetId(), tile.GetId()}, {otherBullet.GetId(), tile.GetId()}};
+    assert((recorder.entered == bulletsOnTile) && "The collision system should honor the layers of the collider components");
+}
@@ -0,0 +1,16 @@
+#ifndef COLLISION_TEST_H
+#define COLLISION_TEST_H
+
+#include "../Collision/Broadphase.h"
+
+void testSpatialHashBroadphase();
+void testSweepAndPruneBroadphase();
+void testAabbTreeBroadphase();
+void testOverlapKernel();
+void testParallelBroadphase();
+void testCollisionEventOrder();
+void testCollisionContactEvents();
+void testCollisionContactsOfReusedIds();
+void testCollisionLayers();
+
+#endif
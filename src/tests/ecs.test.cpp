@@ -1,5 +1,7 @@
 #include "ecs.test.h"
+#include "../ECS/World.h"
 #include <iostream>
+#include <thread>
 // uncoment to disable assert 
 //#define NDEBUG 1
 #include <cassert>
@@ -39,6 +41,249 @@ void testRemoveEntityFromSystem() {
     assert((entities.size() == 7) && "Should be 7 entities");
 }
 
+struct TestPositionComponent {
+    int x;
+    int y;
+    TestPositionComponent(int x = 0, int y = 0) : x{x}, y{y} {}
+};
+
+class TestPositionSystem: public System {
+    public:
+        TestPositionSystem() {
+            RequireComponent<TestPositionComponent>();
+        }
+};
+
+void testRegistryMerge() {
+    Registry live;
+    live.AddSystem<TestPositionSystem>();
+    live.CreateEntity().AddComponent<TestPositionComponent>(1, 1);
+    live.Update();
+
+    // A level built on its own, as a worker thread would do
+    Registry level;
+    for (int i = 0; i < 5; i++) {
+        level.CreateEntity().AddComponent<TestPositionComponent>(10 + i, 20 + i);
+    }
+    Entity dead = level.CreateEntity();
+    dead.Kill();
+
+    const auto newIds = live.Merge(level);
+    live.Update();
+
+    assert((newIds.size() == 6) && "Should map every id of the merged registry");
+    assert((newIds[5] == INVALID_ENTITY_ID) && "Killed entities should not be merged");
+    for (int i = 0; i < 5; i++) {
+        Entity entity(newIds[i]);
+        entity.registry = &live;
+        assert(entity.HasComponent<TestPositionComponent>() && "Merged entity should keep its components");
+        assert((entity.GetComponent<TestPositionComponent>().x == 10 + i) && "Merged component should keep its data");
+    }
+    assert((live.GetSystem<TestPositionSystem>().GetSystemEntities().size() == 6) && "Merged entities should reach the systems");
+}
+
+void testRegistrySwap() {
+    Registry live;
+    live.AddSystem<TestPositionSystem>();
+    live.CreateEntity().AddComponent<TestPositionComponent>(1, 1);
+    live.Update();
+
+    Registry level;
+    for (int i = 0; i < 3; i++) {
+        level.CreateEntity().AddComponent<TestPositionComponent>(i, i);
+    }
+
+    live.Swap(level);
+    live.Update();
+
+    const auto& entities = live.GetSystem<TestPositionSystem>().GetSystemEntities();
+    assert((entities.size() == 3) && "Systems should hold the swapped in entities");
+    for (const auto& entity : entities) {
+        assert((entity.registry == &live) && "Swapped in entities should belong to the live registry");
+    }
+}
+
+void testRegistryBulkKill() {
+    Registry registry;
+    registry.AddSystem<TestPositionSystem>();
+    for (int i = 0; i < 10; i++) {
+        Entity entity = registry.CreateEntity();
+        entity.AddComponent<TestPositionComponent>(i, i);
+        if (i < 4) {
+            entity.Group("tiles");
+        }
+    }
+    registry.Update();
+    auto& entities = registry.GetSystem<TestPositionSystem>().GetSystemEntities();
+
+    registry.KillGroup("tiles");
+    assert((entities.size() == 6) && "Group entities should leave the systems at once");
+    assert(registry.GetEntitiesByGroup("tiles").empty() && "Killed group should be empty");
+
+    Signature signature;
+    signature.set(Component<TestPositionComponent>::GetId());
+    registry.KillAllWithSignature(signature);
+    assert(entities.empty() && "Every entity with the signature should be killed");
+
+    // Killed ids are reused
+    Entity reused = registry.CreateEntity();
+    assert((reused.GetId() < 10) && "Bulk killed ids should be reused");
+
+    registry.Clear();
+    assert((registry.CreateEntity().GetId() == 0) && "Cleared registry should start over from id 0");
+}
+
+struct TestNameComponent {
+    std::string name;
+    TestNameComponent(const std::string& name = "") : name{name} {}
+};
+
+void testCloneEntity() {
+    Registry registry;
+    Entity prefab = registry.CreateEntity();
+    prefab.AddComponent<TestPositionComponent>(4, 2);
+    prefab.AddComponent<TestNameComponent>("tank");
+    prefab.Group("enemies");
+
+    const auto& positionInfo = IComponent::GetInfo(Component<TestPositionComponent>::GetId());
+    const auto& nameInfo = IComponent::GetInfo(Component<TestNameComponent>::GetId());
+    assert(positionInfo.isTriviallyCopyable && positionInfo.serialize && "POD components should be serializable");
+    assert(!nameInfo.isTriviallyCopyable && !nameInfo.serialize && "Components with strings are not trivially copyable");
+    assert(positionInfo.assign && nameInfo.assign && "Clones copy assign into live components");
+
+    Entity clone = registry.CloneEntity(prefab);
+    assert((clone != prefab) && "Clone should be a new entity");
+    assert((clone.GetComponent<TestPositionComponent>().y == 2) && "Clone should copy POD components");
+    assert((clone.GetComponent<TestNameComponent>().name == "tank") && "Clone should copy non POD components");
+    assert(clone.BelongsToGroup("enemies") && "Clone should keep the group");
+}
+
+void testConcurrentCreateEntity() {
+    Registry registry;
+    registry.AddSystem<TestPositionSystem>();
+    for (int i = 0; i < 100; i++) {
+        registry.CreateEntity().AddComponent<TestPositionComponent>();
+    }
+    registry.Update();
+    Signature signature;
+    signature.set(Component<TestPositionComponent>::GetId());
+    registry.KillAllWithSignature(signature);
+
+    // Spawners on worker threads share the 100 free ids and then reserve new ones
+    constexpr int threadCount = 4;
+    constexpr int entitiesPerThread = 250;
+    std::vector<std::vector<std::size_t>> idsPerThread(threadCount);
+    std::vector<std::thread> spawners;
+    for (int t = 0; t < threadCount; t++) {
+        spawners.emplace_back([&registry, &idsPerThread, t]() {
+            for (int i = 0; i < entitiesPerThread; i++) {
+                Entity entity = registry.CreateEntity();
+                idsPerThread[t].push_back(entity.GetId());
+                // Deferred until the owner thread collects the spawns
+                entity.AddComponent<TestPositionComponent>(t, i);
+            }
+        });
+    }
+    for (auto& spawner : spawners) {
+        spawner.join();
+    }
+    registry.Update();
+
+    std::set<std::size_t> uniqueIds;
+    for (const auto& ids : idsPerThread) {
+        uniqueIds.insert(ids.begin(), ids.end());
+    }
+    assert((uniqueIds.size() == threadCount * entitiesPerThread) && "Concurrent spawns should get unique ids");
+    assert((*uniqueIds.rbegin() == threadCount * entitiesPerThread - 1) && "Free ids should be reused before new ones");
+
+    // The components added on the workers reached the pools and the systems
+    const auto& positioned = registry.GetSystem<TestPositionSystem>().GetSystemEntities();
+    assert((positioned.size() == threadCount * entitiesPerThread) && "Components added off the owner thread should apply on Update");
+    Entity spawned(idsPerThread[2][5]);
+    spawned.registry = &registry;
+    const auto& position = spawned.GetComponent<TestPositionComponent>();
+    assert((position.x == 2 && position.y == 5) && "Deferred components should keep their arguments");
+
+    // Once registered, worker spawned entities accept components directly
+    spawned.AddComponent<TestPositionComponent>(7, 7);
+    assert((spawned.GetComponent<TestPositionComponent>().x == 7) && "Registered worker spawned entity should accept components");
+}
+
+class TestNameSystem: public System {
+    public:
+        TestNameSystem() {
+            RequireComponent<TestNameComponent>();
+        }
+};
+
+void testSystemMembershipIndex() {
+    Registry registry;
+    registry.AddSystem<TestPositionSystem>();
+    registry.AddSystem<TestNameSystem>();
+
+    Entity positioned = registry.CreateEntity();
+    positioned.AddComponent<TestPositionComponent>();
+    Entity named = registry.CreateEntity();
+    named.AddComponent<TestNameComponent>("radar");
+    Entity both = registry.CreateEntity();
+    both.AddComponent<TestPositionComponent>();
+    both.AddComponent<TestNameComponent>("tank");
+    registry.Update();
+
+    const auto& positionEntities = registry.GetSystem<TestPositionSystem>().GetSystemEntities();
+    const auto& nameEntities = registry.GetSystem<TestNameSystem>().GetSystemEntities();
+    assert((positionEntities.size() == 2) && "Position system should only get entities with a position");
+    assert((nameEntities.size() == 2) && "Name system should only get entities with a name");
+
+    both.Kill();
+    registry.Update();
+    assert((positionEntities.size() == 1 && nameEntities.size() == 1) && "Killed entity should leave every system it was in");
+
+    registry.RemoveSystem<TestNameSystem>();
+    named.Kill();
+    registry.Update();
+    assert((positionEntities.size() == 1) && "Removing a system should not disturb the others");
+}
+
+class TestCountingSystem: public System {
+    public:
+        int updates = 0;
+        int steps = 0;
+
+        TestCountingSystem() {
+            RequireComponent<TestPositionComponent>();
+        }
+
+        void Update() {
+            updates++;
+        }
+
+        void Update(int stepCount) {
+            steps += stepCount;
+        }
+};
+
+void testWorld() {
+    Registry registry;
+    {
+        World<TestCountingSystem, TestNameSystem> world{registry};
+        registry.CreateEntity().AddComponent<TestPositionComponent>();
+        registry.Update();
+
+        assert((world.GetSystem<TestCountingSystem>().GetSystemEntities().size() == 1) && "World systems should get entities from the registry");
+
+        world.Update<TestCountingSystem>();
+        world.Update<TestCountingSystem>(3);
+        assert((world.GetSystem<TestCountingSystem>().updates == 1) && "Update() should reach the named system");
+        assert((world.GetSystem<TestCountingSystem>().steps == 3) && "Update(args) should pick the overload taking those arguments");
+
+        int systemCount = 0;
+        world.ForEachSystem([&systemCount](System&) { systemCount++; });
+        assert((systemCount == 2) && "ForEachSystem should visit every system");
+    }
+    assert(!registry.HasSystem<TestCountingSystem>() && "World systems should be removed with the world");
+}
+
 void addEntitiesToSystem(System& system, int count) {
     for (int i = 0; i < count; i++) {
         Entity entity(i);
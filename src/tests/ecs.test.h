@@ -6,6 +6,13 @@
 /*** TESTS ***/
 void testAddEntityToSystem();
 void testRemoveEntityFromSystem();
+void testRegistryMerge();
+void testRegistrySwap();
+void testRegistryBulkKill();
+void testCloneEntity();
+void testConcurrentCreateEntity();
+void testSystemMembershipIndex();
+void testWorld();
 
 /*** HELPER FUNCTIONS ***/
 void printEntities(const std::vector<Entity>& entities);
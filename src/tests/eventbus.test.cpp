@@ -0,0 +1,414 @@
+#include "eventbus.test.h"
+#include "../Events/CollisionEvent.h"
+#include <cassert>
+#include <thread>
+
+class TestEvent : public Event {
+    public:
+        int value;
+        TestEvent(int value): value(value) {}
+};
+
+class CountedEvent : public Event {
+    public:
+        static inline int constructions = 0;
+        CountedEvent() { constructions++; }
+};
+
+class TestListener {
+    public:
+        int received = 0;
+        int lastValue = 0;
+        SubscriptionHandle subscription;
+
+        void onTestEvent(TestEvent& event) {
+            received++;
+            lastValue = event.value;
+        }
+
+        void onCountedEvent(CountedEvent& event) {
+            received++;
+        }
+
+        int batches = 0;
+        void onTestEvents(EventSpan<TestEvent> events) {
+            batches++;
+            received += static_cast<int>(events.size());
+            lastValue = events[events.size() - 1].value;
+        }
+
+        // Drops its own subscription from inside the callback
+        void onTestEventOnce(TestEvent& event) {
+            received++;
+            subscription.Unsubscribe();
+        }
+};
+
+void testEventBusSubscriptionHandle() {
+    EventBus eventBus;
+    TestListener listener;
+
+    {
+        auto handle = eventBus.SubscribeToEvent<&TestListener::onTestEvent>(listener);
+        eventBus.EmitEvent<TestEvent>(1);
+        eventBus.EmitEvent<TestEvent>(2);
+        assert((listener.received == 2 && listener.lastValue == 2) && "Subscriptions should persist across emits");
+        assert((eventBus.GetSubscriberCount() == 1) && "Subscribing once should register one callback");
+    }
+
+    eventBus.EmitEvent<TestEvent>(3);
+    assert((listener.received == 2) && "Destroying the handle should unsubscribe");
+    assert((eventBus.GetSubscriberCount() == 0) && "The callback should be removed with its handle");
+
+    listener.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvent>(listener);
+    auto moved = std::move(listener.subscription);
+    assert((!listener.subscription.IsSubscribed() && moved.IsSubscribed()) && "Moving a handle should transfer the subscription");
+    moved.Unsubscribe();
+    eventBus.EmitEvent<TestEvent>(4);
+    assert((listener.received == 2 && eventBus.GetSubscriberCount() == 0) && "Unsubscribing explicitly should stop the callbacks");
+}
+
+void testEventBusUnsubscribeDuringDispatch() {
+    EventBus eventBus;
+    TestListener once;
+    TestListener always;
+
+    once.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEventOnce>(once);
+    always.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvent>(always);
+
+    eventBus.EmitEvent<TestEvent>(1);
+    assert((once.received == 1 && always.received == 1) && "Every subscriber should receive the event being dispatched");
+    assert((eventBus.GetSubscriberCount() == 1) && "A callback unsubscribing itself should be removed after the dispatch");
+
+    eventBus.EmitEvent<TestEvent>(2);
+    assert((once.received == 1 && always.received == 2) && "Unsubscribed callbacks should not receive later events");
+}
+
+void testEventBusEmitConstructsOnce() {
+    EventBus eventBus;
+    std::vector<TestListener> listeners(3);
+    for (auto& listener : listeners) {
+        listener.subscription = eventBus.SubscribeToEvent<&TestListener::onCountedEvent>(listener);
+    }
+
+    CountedEvent::constructions = 0;
+    eventBus.EmitEvent<CountedEvent>();
+    assert((CountedEvent::constructions == 1) && "An event should be constructed once per emit");
+    for (const auto& listener : listeners) {
+        assert((listener.received == 1) && "Every subscriber should receive the emitted event");
+    }
+
+    for (auto& listener : listeners) {
+        listener.subscription.Unsubscribe();
+    }
+    eventBus.EmitEvent<CountedEvent>();
+    assert((CountedEvent::constructions == 1) && "Events without subscribers should not be constructed");
+}
+
+class RequeueingListener {
+    public:
+        EventBus* eventBus = nullptr;
+        int received = 0;
+
+        // Queues a follow-up event while its own type is being dispatched
+        void onTestEvent(TestEvent& event) {
+            received++;
+            if (event.value == 1) {
+                eventBus->Enqueue<TestEvent>(2);
+            }
+        }
+};
+
+void testEventBusBatchDispatch() {
+    EventBus eventBus;
+    TestListener batch;
+    TestListener single;
+    batch.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvents>(batch);
+    single.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvent>(single);
+
+    for (int i = 1; i <= 3; i++) {
+        eventBus.Enqueue<TestEvent>(i);
+    }
+    assert((batch.received == 0 && eventBus.GetQueuedCount<TestEvent>() == 3) && "Enqueued events should wait for a dispatch");
+
+    eventBus.Dispatch<TestEvent>();
+    assert((batch.batches == 1 && batch.received == 3 && batch.lastValue == 3) && "Batch subscribers should get every queued event in one call");
+    assert((single.received == 3 && single.lastValue == 3) && "Other subscribers should get one call per queued event");
+    assert((eventBus.GetQueuedCount<TestEvent>() == 0) && "Dispatching should empty the queue");
+
+    eventBus.Dispatch<TestEvent>();
+    assert((batch.batches == 1) && "Dispatching an empty queue should not call the subscribers");
+
+    EventBus requeueBus;
+    RequeueingListener requeueing;
+    requeueing.eventBus = &requeueBus;
+    auto handle = requeueBus.SubscribeToEvent<&RequeueingListener::onTestEvent>(requeueing);
+    requeueBus.Enqueue<TestEvent>(1);
+    requeueBus.Dispatch<TestEvent>();
+    assert((requeueing.received == 1 && requeueBus.GetQueuedCount<TestEvent>() == 1) && "Events enqueued while dispatching should wait for the next dispatch");
+    requeueBus.Dispatch<TestEvent>();
+    assert((requeueing.received == 2) && "Requeued events should be delivered by the next dispatch");
+}
+
+class OrderListener {
+    public:
+        std::vector<int> values;
+
+        void onTestEvents(EventSpan<TestEvent> events) {
+            for (const auto& event : events) {
+                values.push_back(event.value);
+            }
+        }
+};
+
+void testEventBusLaneMerge() {
+    constexpr int laneCount = 4;
+    constexpr int eventsPerLane = 500;
+
+    EventBus eventBus;
+    OrderListener listener;
+    auto handle = eventBus.SubscribeToEvent<&OrderListener::onTestEvents>(listener);
+
+    eventBus.ReserveLanes<TestEvent>(laneCount);
+    eventBus.Enqueue<TestEvent>(-1);
+
+    // Start the producers in reverse so their timing differs from the lane order
+    std::vector<std::thread> producers;
+    for (int lane = laneCount - 1; lane >= 0; lane--) {
+        producers.emplace_back([&eventBus, lane]() {
+            for (int i = 0; i < eventsPerLane; i++) {
+                eventBus.EnqueueToLane<TestEvent>(lane, lane * eventsPerLane + i);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    assert((eventBus.GetQueuedCount<TestEvent>() == 1 + laneCount * eventsPerLane) && "Staged events should be counted as queued");
+
+    eventBus.Dispatch<TestEvent>();
+    assert((listener.values.size() == 1 + laneCount * eventsPerLane) && "Every staged event should be dispatched");
+    assert((listener.values.front() == -1) && "Events enqueued directly should come first");
+    for (int i = 0; i < laneCount * eventsPerLane; i++) {
+        assert((listener.values[i + 1] == i) && "Lanes should be merged in lane order");
+    }
+    assert((eventBus.GetQueuedCount<TestEvent>() == 0) && "Dispatching should empty the lanes");
+}
+
+class CollisionListener {
+    public:
+        int received = 0;
+        SubscriptionHandle subscription;
+
+        void onCollision(CollisionEvent& event) {
+            received++;
+        }
+};
+
+void testEventBusEntityRouting() {
+    Registry registry;
+    Entity tank = registry.CreateEntity();
+    Entity truck = registry.CreateEntity();
+    Entity chopper = registry.CreateEntity();
+    Entity radar = registry.CreateEntity();
+    registry.Update();
+    tank.Group("enemies");
+    truck.Group("enemies");
+
+    EventBus eventBus;
+    CollisionListener all;
+    CollisionListener tankListener;
+    CollisionListener radarListener;
+    CollisionListener enemiesListener;
+    all.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(all);
+    tankListener.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(tankListener, tank);
+    radarListener.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(radarListener, radar);
+    enemiesListener.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(enemiesListener, std::string("enemies"));
+
+    eventBus.EmitEvent<CollisionEvent>(tank, chopper);
+    eventBus.Enqueue<CollisionEvent>(chopper, truck);
+    eventBus.Enqueue<CollisionEvent>(tank, truck);
+    eventBus.Dispatch<CollisionEvent>();
+
+    assert((all.received == 3) && "Subscribers without a target should receive every event");
+    assert((tankListener.received == 2) && "Entity subscribers should only receive the events targeting their entity");
+    assert((radarListener.received == 0) && "Entity subscribers should not receive events targeting other entities");
+    assert((enemiesListener.received == 3) && "Group subscribers should receive each event targeting the group once");
+
+    tankListener.subscription.Unsubscribe();
+    eventBus.EmitEvent<CollisionEvent>(tank, radar);
+    assert((tankListener.received == 2 && radarListener.received == 1) && "Unsubscribing should only remove the targeted subscription");
+    assert((eventBus.GetSubscriberCount() == 3) && "Targeted subscriptions should be counted as subscribers");
+}
+
+void testEventBusRecycledEntityRouting() {
+    Registry registry;
+    Entity tank = registry.CreateEntity();
+    Entity radar = registry.CreateEntity();
+    registry.Update();
+
+    EventBus eventBus;
+    CollisionListener tankListener;
+    CollisionListener radarListener;
+    tankListener.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(tankListener, tank);
+    radarListener.subscription = eventBus.SubscribeToEvent<&CollisionListener::onCollision>(radarListener, radar);
+
+    // The id of the killed tank goes to the next entity
+    tank.Kill();
+    registry.Update();
+    Entity jeep = registry.CreateEntity();
+    registry.Update();
+    assert((jeep.GetId() == tank.GetId()) && "The killed entity id should be reused");
+
+    eventBus.EmitEvent<CollisionEvent>(jeep, radar);
+    assert((tankListener.received == 0) && "Subscribers of a killed entity should not receive the events of the entity reusing its id");
+    assert((radarListener.received == 1) && "Subscribers of a living entity should still receive its events");
+    assert((eventBus.GetSubscriberCount() == 1) && "Subscribers of a killed entity should be dropped once its id is reused");
+
+    // Swapping in another world gives the same ids to other entities
+    Registry level;
+    level.CreateEntity();
+    level.CreateEntity();
+    level.Update();
+    registry.Swap(level);
+    registry.Update();
+    Entity tower(jeep.GetId());
+    Entity bunker(radar.GetId());
+    tower.registry = &registry;
+    bunker.registry = &registry;
+    eventBus.EmitEvent<CollisionEvent>(tower, bunker);
+    assert((radarListener.received == 1) && "Subscribers should not receive the events of entities swapped in under their id");
+}
+
+// Only used here so its type id comes after the one of CollisionEvent
+class TurretHitEvent : public CollisionEvent {
+    public:
+        using CollisionEvent::CollisionEvent;
+};
+
+class TurretListener {
+    public:
+        int received = 0;
+
+        void onTurretHit(TurretHitEvent& event) {
+            received++;
+        }
+};
+
+void testEventBusTargetedListenersPerType() {
+    Registry registry;
+    Entity turret = registry.CreateEntity();
+    Entity shell = registry.CreateEntity();
+    registry.Update();
+
+    EventBus eventBus;
+    TurretListener listener;
+    auto handle = eventBus.SubscribeToEvent<&TurretListener::onTurretHit>(listener, turret);
+    assert(eventBus.HasSubscribers<TurretHitEvent>() && "A targeted subscription should count as a listener of its type");
+    assert(!eventBus.HasSubscribers<CollisionEvent>() && "A targeted subscription should not make other types listened to");
+
+    // Nobody listens to the collisions, their duplicates are dropped without being coalesced
+    eventBus.Enqueue<CollisionEvent>(turret, shell);
+    eventBus.Enqueue<CollisionEvent>(shell, turret);
+    eventBus.Dispatch<CollisionEvent>();
+    assert((eventBus.GetQueuedCount<CollisionEvent>() == 0) && "Events without listeners should be dropped");
+#if EVENTBUS_STATS
+    assert((eventBus.GetStats()[EventType<CollisionEvent>::GetId()].coalescedTotal == 0) && "Events without listeners should not be coalesced");
+#endif
+
+    eventBus.EmitEvent<TurretHitEvent>(shell, turret);
+    assert((listener.received == 1) && "Targeted subscribers should still receive their events");
+    handle.Unsubscribe();
+    assert(!eventBus.HasSubscribers<TurretHitEvent>() && "A type should stop being listened to once its targeted subscribers are gone");
+}
+
+void testEventBusStats() {
+#if EVENTBUS_STATS
+    EventBus eventBus;
+    eventBus.SetStatsDumpInterval(0);
+    TestListener first;
+    TestListener second;
+    first.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvent>(first);
+    second.subscription = eventBus.SubscribeToEvent<&TestListener::onTestEvents>(second);
+
+    eventBus.EmitEvent<TestEvent>(1);
+    eventBus.Enqueue<TestEvent>(2);
+    eventBus.Enqueue<TestEvent>(3);
+    eventBus.Dispatch<TestEvent>();
+    eventBus.EndFrame();
+    eventBus.EmitEvent<TestEvent>(4);
+
+    const auto stats = eventBus.GetStats();
+    const auto& testEventStats = stats[EventType<TestEvent>::GetId()];
+    assert((testEventStats.name.find("TestEvent") != std::string::npos) && "Event types should be reported by name");
+    assert((testEventStats.emitsLastFrame == 3 && testEventStats.emitsThisFrame == 1) && "Emits should be counted per frame");
+    assert((testEventStats.maxEmitsPerFrame == 3 && testEventStats.emitsTotal == 4) && "Frame maximum and total emits should be kept");
+    assert((testEventStats.subscriberCount == 2) && "Subscribers should be counted per event type");
+    assert((testEventStats.subscribers[0].eventCount == 4 && testEventStats.subscribers[1].eventCount == 4) && "Delivered events should be counted per subscriber");
+    assert((testEventStats.subscribers[1].callCount == 3) && "A dispatch should be a single call for batch subscribers");
+    assert((testEventStats.subscribers[0].maxNs <= testEventStats.subscribers[0].totalNs) && "The longest call should not exceed the total handler time");
+
+    // Emits nobody listens to are still counted
+    eventBus.EmitEvent<CountedEvent>();
+    const auto unheardStats = eventBus.GetStats()[EventType<CountedEvent>::GetId()];
+    assert((unheardStats.emitsTotal == 1 && unheardStats.subscriberCount == 0) && "Emits without subscribers should be counted");
+#endif
+}
+
+class CollisionOrderListener {
+    public:
+        std::vector<std::pair<std::size_t, std::size_t>> collisions;
+
+        void onCollisions(EventSpan<CollisionEvent> events) {
+            for (const auto& event : events) {
+                collisions.emplace_back(event.a.GetId(), event.b.GetId());
+            }
+        }
+};
+
+void testEventBusCoalescing() {
+    Registry registry;
+    Entity tank = registry.CreateEntity();
+    Entity truck = registry.CreateEntity();
+    Entity chopper = registry.CreateEntity();
+
+    EventBus eventBus;
+    CollisionOrderListener listener;
+    auto handle = eventBus.SubscribeToEvent<&CollisionOrderListener::onCollisions>(listener);
+
+    eventBus.ReserveLanes<CollisionEvent>(2);
+    eventBus.Enqueue<CollisionEvent>(tank, truck);
+    eventBus.Enqueue<CollisionEvent>(truck, tank);
+    eventBus.EnqueueToLane<CollisionEvent>(0, tank, chopper);
+    eventBus.EnqueueToLane<CollisionEvent>(1, tank, truck);
+    eventBus.EnqueueToLane<CollisionEvent>(1, chopper, tank);
+    eventBus.Dispatch<CollisionEvent>();
+
+    assert((listener.collisions.size() == 2) && "Events with the same key should be delivered once");
+    assert((listener.collisions[0] == std::make_pair(tank.GetId(), truck.GetId())) && "The first event of a key should be kept");
+    assert((listener.collisions[1] == std::make_pair(tank.GetId(), chopper.GetId())) && "Coalescing should keep the queued order");
+
+    eventBus.Enqueue<CollisionEvent>(truck, tank);
+    eventBus.Dispatch<CollisionEvent>();
+    assert((listener.collisions.size() == 3) && "Keys should only be coalesced within a dispatch");
+#if EVENTBUS_STATS
+    assert((eventBus.GetStats()[EventType<CollisionEvent>::GetId()].coalescedTotal == 3) && "Coalesced events should be counted");
+#endif
+
+    // Queued in key order, as the collision system does
+    listener.collisions.clear();
+    eventBus.Enqueue<CollisionEvent>(tank, truck);
+    eventBus.Enqueue<CollisionEvent>(tank, chopper);
+    eventBus.Enqueue<CollisionEvent>(tank, chopper);
+    eventBus.Enqueue<CollisionEvent>(truck, chopper);
+    eventBus.Dispatch<CollisionEvent>();
+    assert((listener.collisions.size() == 3) && "Sorted batches should be coalesced too");
+    assert((listener.collisions[2] == std::make_pair(truck.GetId(), chopper.GetId())) && "Sorted batches should keep their order");
+
+    // Without listeners the queue is dropped
+    handle.Unsubscribe();
+    eventBus.Enqueue<CollisionEvent>(tank, truck);
+    eventBus.EnqueueToLane<CollisionEvent>(1, truck, chopper);
+    eventBus.Dispatch<CollisionEvent>();
+    assert((eventBus.GetQueuedCount<CollisionEvent>() == 0) && "Dispatching without listeners should empty the queue");
+}
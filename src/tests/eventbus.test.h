@@ -0,0 +1,17 @@
+#ifndef EVENTBUS_TEST_H
+#define EVENTBUS_TEST_H
+
+#include "../EventBus/EventBus.h"
+
+void testEventBusSubscriptionHandle();
+void testEventBusUnsubscribeDuringDispatch();
+void testEventBusEmitConstructsOnce();
+void testEventBusBatchDispatch();
+void testEventBusLaneMerge();
+void testEventBusEntityRouting();
+void testEventBusRecycledEntityRouting();
+void testEventBusTargetedListenersPerType();
+void testEventBusStats();
+void testEventBusCoalescing();
+
+#endif
@@ -0,0 +1,35 @@
+#include "jobs.test.h"
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+void testJobSystemParallelFor() {
+    JobSystem jobSystem{3};
+    assert((jobSystem.GetThreadCount() == 4) && "The calling thread should count along with the workers");
+
+    // Several batches in a row reuse the sleeping workers
+    for (std::size_t count : {0, 1, 7, 1000, 4099}) {
+        std::vector<std::atomic<int>> visits(count);
+        std::atomic<bool> isThreadIndexValid{true};
+        jobSystem.ParallelFor(count, 16, [&](std::size_t begin, std::size_t end, std::size_t threadIndex) {
+            if (threadIndex >= jobSystem.GetThreadCount() || end - begin > 16) {
+                isThreadIndexValid = false;
+            }
+            for (auto i = begin; i < end; i++) {
+                visits[i]++;
+            }
+        });
+        assert((isThreadIndexValid) && "Chunks should respect the grain size and get a thread index below the thread count");
+        for (const auto& visit : visits) {
+            assert((visit == 1) && "ParallelFor should run every index exactly once");
+        }
+    }
+
+    JobSystem callerOnly{0};
+    std::size_t total = 0;
+    callerOnly.ParallelFor(100, 8, [&](std::size_t begin, std::size_t end, std::size_t threadIndex) {
+        assert((threadIndex == 0) && "Without workers everything should run on the calling thread");
+        total += end - begin;
+    });
+    assert((total == 100) && "Without workers every chunk should still run");
+}
@@ -0,0 +1,8 @@
+#ifndef JOBS_TEST_H
+#define JOBS_TEST_H
+
+#include "../Jobs/JobSystem.h"
+
+void testJobSystemParallelFor();
+
+#endif
@@ -1,6 +1,182 @@
 #include "logger.test.h"
+#include "../Logger/BinaryLogDecoder.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
 
 void testLogger() {
     Logger::Log("Testing Logger::Log...");
     Logger::Err("Testing Logger::Err...");
-}
\ No newline at end of file
+}
+
+void testLoggerFromThreads() {
+    Logger::Flush();
+    const auto writtenBefore = Logger::GetStats().writtenCount;
+
+    constexpr int threadCount = 4;
+    constexpr int messagesPerThread = 1000;
+    std::vector<std::thread> loggers;
+    for (int t = 0; t < threadCount; t++) {
+        loggers.emplace_back([t]() {
+            for (int i = 0; i < messagesPerThread; i++) {
+                Logger::Log("Thread " + std::to_string(t) + " message " + std::to_string(i));
+            }
+        });
+    }
+    for (auto& logger : loggers) {
+        logger.join();
+    }
+    Logger::Flush();
+
+    assert((Logger::GetStats().writtenCount - writtenBefore == threadCount * messagesPerThread) && "Every message should be written once flushed");
+}
+
+void testLoggerHistoryBudget() {
+    Logger::Flush();
+    Logger::SetHistoryBudget(16 * sizeof(LogRecord));
+    const auto overwrittenBefore = Logger::GetStats().historyOverwrittenCount;
+
+    for (int i = 0; i < 20; i++) {
+        Logger::Log("History message " + std::to_string(i));
+    }
+    Logger::Log(std::string(LogRecord::MAX_MESSAGE_LENGTH + 10, 'x'));
+    Logger::Flush();
+
+    const auto stats = Logger::GetStats();
+    const auto history = Logger::GetHistory();
+    assert((stats.historyCapacity == 16 && history.size() == 16) && "History should stay within its budget");
+    assert((stats.historyOverwrittenCount - overwrittenBefore == 5) && "Overflowing records should be counted");
+    assert((history.front().message.find("History message 5") != std::string::npos) && "History should keep the newest records");
+    assert((stats.truncatedCount >= 1) && "Long messages should be counted as truncated");
+
+    Logger::SetHistoryBudget(Logger::DEFAULT_HISTORY_BUDGET);
+}
+
+void testLoggerLazyFormatting() {
+    int evaluations = 0;
+    auto countEvaluation = [&evaluations]() {
+        evaluations++;
+        return evaluations;
+    };
+
+    Logger::SetLevel(LogType::LOG_INFO);
+    LOG_DEBUG(LogCategory::ECS, "Debug value {}", countEvaluation());
+    assert((evaluations == 0) && "Disabled levels should not evaluate their arguments");
+
+    Logger::SetCategoryEnabled(LogCategory::ECS, false);
+    LOG_INFO(LogCategory::ECS, "Info value {}", countEvaluation());
+    assert((evaluations == 0) && "Disabled categories should not evaluate their arguments");
+    Logger::SetCategoryEnabled(LogCategory::ECS, true);
+
+    LOG_WARNING(LogCategory::ECS, "Entity {} at {} is {}", countEvaluation(), 2.5, "lost");
+    Logger::Flush();
+    assert((evaluations == 1) && "Enabled levels should evaluate their arguments once");
+    const auto history = Logger::GetHistory();
+    assert((history.back().message.find("Entity 1 at 2.500000 is lost") != std::string::npos) && "Arguments should replace the placeholders");
+}
+
+struct TestGridCell {
+    int column;
+    int row;
+};
+
+std::ostream& operator<<(std::ostream& out, const TestGridCell& cell) {
+    return out << cell.column << "x" << cell.row;
+}
+
+void testLoggerArgumentTypes() {
+    LOG_WARNING(LogCategory::GAME, "Cell {} marked {}", TestGridCell{3, 4}, 'a');
+    Logger::Flush();
+    const auto history = Logger::GetHistory();
+    assert((history.back().message.find("Cell 3x4 marked a") != std::string::npos) && "Streamable arguments and chars should be formatted as text");
+}
+
+// Per run path in the temp directory, so parallel runs don't share files
+static std::string binaryLogTestPath(const std::string& name) {
+    const auto ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    return (std::filesystem::temp_directory_path() / ("pikuma-" + name + "-" + std::to_string(ticks) + ".test")).string();
+}
+
+static DecodedLog decodeBinaryLogFile(const std::string& path) {
+    std::vector<char> data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    std::filesystem::remove(path);
+    DecodedLog log;
+    assert((DecodeBinaryLog(data, log) == BinaryLogDecodeResult::OK) && "Binary log should decode");
+    assert(log.isComplete && "Binary log should end with a whole record");
+    return log;
+}
+
+static bool hasDecodedMessage(const DecodedLog& log, const std::string& text) {
+    return std::any_of(log.messages.begin(), log.messages.end(), [&](const DecodedMessage& message) {
+        return FormatLogMessage(log, message) == text;
+    });
+}
+
+void testBinaryLog() {
+    const std::string path = binaryLogTestPath("binary-log");
+    assert(Logger::OpenBinaryLog(path, 4096) && "Binary log file should open");
+    Logger::SetLevel(LogType::LOG_TRACE);
+    for (int i = 0; i < 3; i++) {
+        LOG_TRACE(LogCategory::ECS, "Entity created with id = {} in {}", i, std::string("jungle"));
+    }
+    Logger::Log("Plain text message");
+    Logger::SetLevel(LogType::LOG_INFO);
+    Logger::CloseBinaryLog();
+
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    assert((data.size() > BINARY_LOG_HEADER_SIZE) && "Binary log should hold records");
+    assert((std::memcmp(data.data(), BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) == 0) && "Binary log should start with its magic");
+    assert((data[BINARY_LOG_HEADER_SIZE] == static_cast<char>(BinaryLogRecordKind::FORMAT)) && "Formats should be defined before their first use");
+    assert((data.size() < 4096) && "Closed binary log should be trimmed to its records");
+    file.close();
+
+    const auto log = decodeBinaryLogFile(path);
+    assert((log.messages.size() == 4) && "Every message should be read back");
+    assert(hasDecodedMessage(log, "Entity created with id = 0 in jungle") && "Arguments should be read back");
+    assert(hasDecodedMessage(log, "Entity created with id = 2 in jungle") && "Arguments should be read back");
+    assert(hasDecodedMessage(log, "Plain text message") && "Text messages should be read back");
+}
+
+void testBinaryLogFormatIds() {
+    const std::string path = binaryLogTestPath("binary-log-formats");
+    BinaryLogSink sink;
+    assert(sink.Open(path, 4096) && "Binary log file should open");
+    // Same text at two addresses, as a literal repeated in two translation units
+    const char format[] = "Entity {} moved";
+    const char sameFormat[] = "Entity {} moved";
+    const char otherFormat[] = "Entity {} stopped";
+    const auto id = sink.InternFormat(format);
+    assert((sink.InternFormat(sameFormat) == id) && "Formats should be interned by content");
+    assert((sink.InternFormat(otherFormat) != id) && "Different formats should get different ids");
+    sink.Close();
+    std::filesystem::remove(path);
+}
+
+void testBinaryLogStringCap() {
+    const std::string path = binaryLogTestPath("binary-log-strings");
+    BinaryLogSink sink;
+    assert(sink.Open(path, 1 << 20) && "Binary log file should open");
+    for (std::size_t i = 0; i < BinaryLogSink::MAX_INTERNED_STRINGS; i++) {
+        assert((sink.InternString("entity-" + std::to_string(i)) != BinaryLogSink::INLINE_STRING_ID) && "Strings under the cap should be interned");
+    }
+    const std::string pastCap = "entity-" + std::to_string(BinaryLogSink::MAX_INTERNED_STRINGS);
+    assert((sink.InternString(pastCap) == BinaryLogSink::INLINE_STRING_ID) && "Strings past the cap should be written inline");
+    assert((sink.InternString("entity-0") != BinaryLogSink::INLINE_STRING_ID) && "Interned strings should keep their id");
+
+    sink.Write(static_cast<std::uint8_t>(LogType::LOG_INFO), static_cast<std::uint32_t>(LogCategory::ECS), "Spawned {} next to {}", pastCap, std::string("entity-0"));
+    sink.Close();
+
+    const auto log = decodeBinaryLogFile(path);
+    assert((log.strings.size() == BinaryLogSink::MAX_INTERNED_STRINGS) && "Only strings under the cap should be defined");
+    assert(hasDecodedMessage(log, "Spawned " + pastCap + " next to entity-0") && "Inline and interned strings should be read back");
+}
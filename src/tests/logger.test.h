@@ -4,5 +4,12 @@
 #include "../Logger/Logger.h"
 
 void testLogger();
+void testLoggerFromThreads();
+void testLoggerHistoryBudget();
+void testLoggerLazyFormatting();
+void testLoggerArgumentTypes();
+void testBinaryLog();
+void testBinaryLogFormatIds();
+void testBinaryLogStringCap();
 
 #endif
\ No newline at end of file
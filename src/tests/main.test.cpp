@@ -1,5 +1,8 @@
 #include "logger.test.h"
 #include "ecs.test.h"
+#include "eventbus.test.h"
+#include "collision.test.h"
+#include "jobs.test.h"
 #include "tilemapLoader.test.h"
 
 int main() {
@@ -7,6 +10,40 @@ int main() {
     // testAddEntityToSystem();
     // testRemoveEntityFromSystem();
     testTileMapLoader();
+    testRegistryMerge();
+    testRegistrySwap();
+    testRegistryBulkKill();
+    testCloneEntity();
+    testConcurrentCreateEntity();
+    testSystemMembershipIndex();
+    testWorld();
+    testLoggerFromThreads();
+    testLoggerHistoryBudget();
+    testLoggerLazyFormatting();
+    testLoggerArgumentTypes();
+    testBinaryLog();
+    testBinaryLogFormatIds();
+    testBinaryLogStringCap();
+    testEventBusSubscriptionHandle();
+    testEventBusUnsubscribeDuringDispatch();
+    testEventBusEmitConstructsOnce();
+    testEventBusBatchDispatch();
+    testEventBusLaneMerge();
+    testEventBusEntityRouting();
+    testEventBusRecycledEntityRouting();
+    testEventBusTargetedListenersPerType();
+    testEventBusStats();
+    testEventBusCoalescing();
+    testSpatialHashBroadphase();
+    testSweepAndPruneBroadphase();
+    testAabbTreeBroadphase();
+    testOverlapKernel();
+    testJobSystemParallelFor();
+    testParallelBroadphase();
+    testCollisionEventOrder();
+    testCollisionContactEvents();
+    testCollisionContactsOfReusedIds();
+    testCollisionLayers();
 
     return 0;
 }
\ No newline at end of file